@@ -61,6 +61,57 @@ options.register('vtxseed',345678,
     "Vertex Smear Seed"
 )
 
+options.register('fused', False,
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.bool,
+    "Also run DIGI-L1-DIGI2RAW, HLT:GRun and RAW2DIGI-L1Reco-RECO in this process, outputFile is then the RECO file"
+)
+options.register('rawOutputFile', '',
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.string,
+    "With fused=True, also write the GEN-SIM-RAW events after HLT to this file (empty for none)"
+)
+options.register('fusedGlobalTag', '106X_upgrade2018_realistic_v11_L1v1',
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.string,
+    "With fused=True, conditions used by every step of the single process"
+)
+options.register('reportFile', '',
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.string,
+    "JSON file for the end-of-job report of filter efficiency and timing (empty for the log only)"
+)
+options.register('numberOfThreads', 1,
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.int,
+    "Number of threads used by cmsRun"
+)
+options.register('numberOfStreams', 0,
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.int,
+    "Number of concurrent events (0 means one per thread)"
+)
+options.register('firstEvent', 1,
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.int,
+    "Number of the first event, for jobs run in blocks"
+)
+options.register('eventsPerLumi', 0,
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.int,
+    "Events per luminosity block, numbered from firstEvent as in an uninterrupted job (0 keeps the source default)"
+)
+options.register('saveRandomState', '',
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.string,
+    "File in the working directory the random engine states are written to after every event"
+)
+options.register('restoreRandomState', '',
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.string,
+    "saveRandomState file of the previous block to start the random engines from instead of the seeds"
+)
+
 options.parseArguments()
 outputFile = options.outputFile
 stringToReplace = "_numEvent{}".format(options.maxEvents)
@@ -79,10 +130,28 @@ if options.seeded:
     process.rndmStore = cms.EDProducer("RandomEngineStateProducer")
 
 # Input source
-process.source = cms.Source("EmptySource")
+process.source = cms.Source("EmptySource",
+    firstEvent = cms.untracked.uint32(options.firstEvent)
+)
+if options.eventsPerLumi > 0:
+    process.source.numberEventsInLuminosityBlock = cms.untracked.uint32(options.eventsPerLumi)
+    process.source.firstLuminosityBlock = cms.untracked.uint32((options.firstEvent - 1) // options.eventsPerLumi + 1)
+
+# Event-level checkpoints: a block continues from the engine states at the end of the previous block, which
+# only describe the whole job when a single stream draws every event in order
+if options.saveRandomState or options.restoreRandomState:
+    if (options.numberOfStreams or options.numberOfThreads) != 1:
+        raise RuntimeError("saveRandomState and restoreRandomState need a single stream")
+    if '/' in options.saveRandomState:
+        raise RuntimeError("saveRandomState must be a file name in the working directory, got {}".format(options.saveRandomState))
+    if options.saveRandomState:
+        process.RandomNumberGeneratorService.saveFileName = cms.untracked.string(options.saveRandomState)
+    if options.restoreRandomState:
+        process.RandomNumberGeneratorService.restoreFileName = cms.untracked.string(options.restoreRandomState)
 
 process.options = cms.untracked.PSet(
-
+    numberOfThreads = cms.untracked.uint32(options.numberOfThreads),
+    numberOfStreams = cms.untracked.uint32(options.numberOfStreams)
 )
 
 # Production Info
@@ -112,11 +181,46 @@ process.RAWSIMoutput = cms.OutputModule("PoolOutputModule",
 
 # Additional output definition
 
+# Fused mode: the later steps run on the events in memory, with the same sequences cmsDriver.py uses for them
+if options.fused:
+    # The HSCP ntuplizer reads the trigger results of process HLT, as in a RECO file of the separate steps.
+    # The GEN and SIM products of the fused file therefore carry the process name HLT as well.
+    process.setName_('HLT')
+
+    process.load('Configuration.StandardSequences.Digi_cff')
+    process.load('Configuration.StandardSequences.SimL1Emulator_cff')
+    process.load('Configuration.StandardSequences.DigiToRaw_cff')
+    process.load('HLTrigger.Configuration.HLT_GRun_cff')
+    process.load('Configuration.StandardSequences.RawToDigi_cff')
+    process.load('Configuration.StandardSequences.L1Reco_cff')
+    process.load('Configuration.StandardSequences.Reconstruction_cff')
+
+    # FEVTDEBUGHLT keeps the GEN particles and the SimHits, so the RECO file also serves the event display
+    process.FEVTDEBUGHLToutput = cms.OutputModule("PoolOutputModule",
+        SelectEvents = cms.untracked.PSet(
+            SelectEvents = cms.vstring('generation_step')
+        ),
+        dataset = cms.untracked.PSet(
+            dataTier = cms.untracked.string('AODSIM'),
+            filterName = cms.untracked.string('')
+        ),
+        fileName = cms.untracked.string(outputFile),
+        outputCommands = process.FEVTDEBUGHLTEventContent.outputCommands,
+        splitLevel = cms.untracked.int32(0)
+    )
+
+    # The GEN-SIM output becomes the optional GEN-SIM-RAW file written after HLT
+    process.RAWSIMoutput.fileName = cms.untracked.string(options.rawOutputFile)
+    process.RAWSIMoutput.dataset.dataTier = cms.untracked.string('GEN-SIM-RAW')
+
 # Other statements
 process.XMLFromDBSource.label = cms.string("Extended")
 process.genstepfilter.triggerConditions=cms.vstring("generation_step")
 from Configuration.AlCa.GlobalTag import GlobalTag
 process.GlobalTag = GlobalTag(process.GlobalTag, '106X_upgrade2018_realistic_v4', '')
+if options.fused:
+    # One process has one set of conditions, the separate steps used v4 up to HLT and v11_L1v1 for RECO
+    process.GlobalTag = GlobalTag(process.GlobalTag, options.fusedGlobalTag, '')
 
 process.dirhadrongenfilter = cms.EDFilter("MCParticlePairFilter",
     MaxEta = cms.untracked.vdouble(100.0, 100.0),
@@ -222,6 +326,16 @@ process.MessageLogger = cms.Service(
 
 process.ProductionFilterSequence = cms.Sequence(process.generator+process.dirhadrongenfilter)
 
+# End-of-job report of the pair filter efficiency, time per accepted event and Geant4 time per R-hadron species
+process.SpikedRHadronGenSimTimer = cms.Service("SpikedRHadronGenSimTimer",
+    simulationModule = cms.untracked.string('g4SimHits')
+)
+process.genSimReport = cms.EDAnalyzer("SpikedRHadronGenSimReport",
+    gen_info = cms.InputTag("genParticles"),
+    massPoint = cms.int32(options.mass),
+    reportFile = cms.string(options.reportFile)
+)
+
 # Path and EndPath definitions
 process.generation_step = cms.Path(process.pgen)
 process.simulation_step = cms.Path(process.psim)
@@ -231,12 +345,47 @@ process.RAWSIMoutput_step = cms.EndPath(process.RAWSIMoutput)
 
 # Schedule definition
 process.schedule = cms.Schedule(process.generation_step,process.genfiltersummary_step,process.simulation_step,process.endjob_step,process.RAWSIMoutput_step)
+if options.fused:
+    process.digitisation_step = cms.Path(process.pdigi)
+    process.L1simulation_step = cms.Path(process.SimL1Emulator)
+    process.digi2raw_step = cms.Path(process.DigiToRaw)
+    process.raw2digi_step = cms.Path(process.RawToDigi)
+    process.L1Reco_step = cms.Path(process.L1Reco)
+    process.reconstruction_step = cms.Path(process.reconstruction)
+    process.FEVTDEBUGHLToutput_step = cms.EndPath(process.FEVTDEBUGHLToutput)
+
+    process.schedule = cms.Schedule(process.generation_step,process.genfiltersummary_step,process.simulation_step,process.digitisation_step,process.L1simulation_step,process.digi2raw_step)
+    process.schedule.extend(process.HLTSchedule)
+    process.schedule.extend([process.raw2digi_step,process.L1Reco_step,process.reconstruction_step,process.endjob_step,process.FEVTDEBUGHLToutput_step])
+    if options.rawOutputFile:
+        process.schedule.append(process.RAWSIMoutput_step)
 from PhysicsTools.PatAlgos.tools.helpers import associatePatAlgosToolsTask
 associatePatAlgosToolsTask(process)
 # filter all path with the production filter sequence
 for path in process.paths:
 	getattr(process,path).insert(0, process.ProductionFilterSequence)
 
+# Generation -> pair filter -> simulation -> report. Events rejected by dirhadrongenfilter stop the path before
+# g4SimHits, so Geant4 only ever runs on accepted events. Fail at configuration if that order is ever broken.
+process.simulation_step += process.genSimReport
+from FWCore.ParameterSet.SequenceTypes import ModuleNodeVisitor
+simulationModules = []
+process.simulation_step.visit(ModuleNodeVisitor(simulationModules))
+simulationLabels = [module.label_() for module in simulationModules if hasattr(module, 'label_')]
+if not simulationLabels.index('generator') < simulationLabels.index('dirhadrongenfilter') < simulationLabels.index('g4SimHits') < simulationLabels.index('genSimReport'):
+    raise RuntimeError("simulation_step must run generator, dirhadrongenfilter, g4SimHits and genSimReport in this order, found {}".format(simulationLabels))
+
+# Store the random engine states of every event when seeded. CMSSW derives the engine seeds of each stream
+# from the initialSeeds above and the stream index, so a single-stream job is reproducible from
+# genseed/g4seed/vtxseed whatever the number of threads. With more than one stream, which stream gets which
+# event depends on scheduling, so an event is reproduced exactly from its stored state instead
+# (RandomNumberGeneratorService.restoreStateLabel = 'rndmStore').
+if options.seeded:
+    process.schedule.associate(cms.Task(process.rndmStore))
+    process.RAWSIMoutput.outputCommands.append('keep *_rndmStore_*_*')
+    if options.fused:
+        process.FEVTDEBUGHLToutput.outputCommands.append('keep *_rndmStore_*_*')
+
 # customisation of the process.
 
 # Automatic addition of the customisation function from SimG4Core.CustomPhysics.Exotica_HSCP_SIM_cfi
@@ -251,6 +400,11 @@ from Configuration.DataProcessing.Utils import addMonitoring
 #call to customisation function addMonitoring imported from Configuration.DataProcessing.Utils
 process = addMonitoring(process)
 
+# The HLT menu needs the MC customisation that cmsDriver.py applies for the HLT:GRun step
+if options.fused:
+    from HLTrigger.Configuration.customizeHLTforMC import customizeHLTforMC
+    process = customizeHLTforMC(process)
+
 # End of customisation functions
 
 # Customisation from command line
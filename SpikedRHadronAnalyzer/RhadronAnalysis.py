@@ -9,6 +9,122 @@ from collections import Counter
 from sklearn.metrics import confusion_matrix, ConfusionMatrixDisplay
 
 
+# Subdetector codes of the 'subDetector' branch written by SpikedRHadronAnalyzer (HitColumns.h)
+subDetectorNames = ['Unknown', 'PixelBarrel', 'PixelEndcap', 'TIB', 'TID', 'TOB', 'TEC', 'EB', 'EE', 'ES',
+                    'HCAL', 'MuonDT', 'MuonCSC', 'MuonRPC', 'MuonGEM']
+
+# Branch names of the ROOT hit dump and the matching CSV column names
+rootToCsvColumns = {'event': 'Event', 'energy': 'Energy Deposit', 'x': 'x [cm]', 'y': 'y [cm]', 'z': 'z [cm]',
+                    'r': 'r [cm]', 'pdg': 'PDG', 'trackEnergy': 'Track Energy', 'px': 'px', 'py': 'py', 'pz': 'pz',
+                    'parentPdg': 'Parent PDG', 'rHadron': 'R-hadron'}
+
+
+def loadHits(file):
+    #Loads the hit dump of SpikedRHadronAnalyzer. ROOT files (outputFormat=root) are read column by column
+    #with uproot and given the CSV column names, anything else is read as CSV.
+    if not file.endswith('.root'):
+        return pd.read_csv(file)
+
+    import uproot
+    df = uproot.open(file)['hits'].arrays(library='pd')
+    df = df.rename(columns=rootToCsvColumns)
+    df['Detector Type'] = pd.Categorical.from_codes(df.pop('subDetector'), subDetectorNames)
+    return df
+
+
+# Summaries written with outputMode=summary, table name and the CSV column names of its ROOT branches
+summaryColumns = {
+    'detIds': {'event': 'Event', 'detId': 'DetId', 'energy': 'Energy Deposit'},
+    'histograms': {'event': 'Event', 'pdg': 'PDG', 'energyLow': 'Energy Bin Low Edge', 'count': 'Hits'},
+    'etaPhi': {'event': 'Event', 'eta': 'eta', 'phi': 'phi', 'energy': 'Energy Deposit'},
+}
+
+
+def loadSummary(file):
+    #Loads the summaries of SpikedRHadronAnalyzer run with outputMode=summary, given the name of the hit output.
+    #Returns a dict of DataFrames keyed by 'detIds', 'histograms' and 'etaPhi'. Every table has a 'Detector Type'
+    #column, the eta-phi grid holds one grid per subdetector, so select a detector type before summing cells.
+    tables = {}
+    if file.endswith('.root'):
+        import uproot
+        rootFile = uproot.open(file)
+        for name, columns in summaryColumns.items():
+            df = rootFile[name].arrays(library='pd').rename(columns=columns)
+            if 'subDetector' in df:
+                df['Detector Type'] = pd.Categorical.from_codes(df.pop('subDetector'), subDetectorNames)
+            tables[name] = df
+        return tables
+
+    stem, dot, extension = file.rpartition('.')
+    for name in summaryColumns:
+        df = pd.read_csv(stem + '_' + name + dot + extension if dot and '/' not in extension else file + '_' + name)
+        df['Detector Type'] = pd.Categorical(df['Detector Type'], subDetectorNames)
+        tables[name] = df
+    return tables
+
+
+# Sidecar index "<hit file>.idx" written by SpikedRHadronAnalyzer in outputMode=hits (HitIndex.h): a 32 byte
+# header, then one fixed-size entry per event in the order of the hit file
+indexDtype = np.dtype([('Event', '<u8'), ('Offset', '<u8'), ('Bytes', '<u8'), ('Rows', '<u8'),
+                       ('Tracker Energy', '<f4'), ('ECAL Energy', '<f4'), ('HCAL Energy', '<f4'), ('Muon Energy', '<f4'),
+                       ('Rhad1_px [GeV]', '<f4'), ('Rhad1_py [GeV]', '<f4'), ('Rhad1_pz [GeV]', '<f4'), ('Rhad1_E [GeV]', '<f4'),
+                       ('Rhad2_px [GeV]', '<f4'), ('Rhad2_py [GeV]', '<f4'), ('Rhad2_pz [GeV]', '<f4'), ('Rhad2_E [GeV]', '<f4')])
+indexHeaderDtype = np.dtype([('magic', 'S8'), ('entrySize', '<u4'), ('format', '<u4'), ('events', '<u8'), ('dataSize', '<u8')])
+
+
+def loadIndex(file):
+    #Loads the index of a hit dump, given the name of the hit output. Returns a DataFrame with one row per event:
+    #the offset (byte for CSV, tree entry for ROOT) and row count of its hits, the energy per subdetector and the
+    #momenta of both Rhadrons. Events can be selected on these before any hit is read.
+    header = np.fromfile(file + '.idx', dtype=indexHeaderDtype, count=1)
+    if len(header) != 1 or header['magic'][0] != b'SRHIDX1' or header['entrySize'][0] != indexDtype.itemsize:
+        raise ValueError(file + '.idx is not a hit index of this version')
+    return pd.DataFrame(np.fromfile(file + '.idx', dtype=indexDtype, offset=indexHeaderDtype.itemsize))
+
+
+class HitDump(object):
+    #Random access to the events of a hit dump through its index, without loading the whole file.
+    #CSV dumps are read with the compiled HitDumpReader when the CMSSW library is on the path, otherwise with a
+    #seek to the offset of the event. ROOT dumps read the entry range of the event with uproot.
+    def __init__(self, file):
+        self.file = file
+        self.index = loadIndex(file)
+        self.rows = dict(zip(self.index['Event'], range(len(self.index))))
+        self.reader = None
+        if not file.endswith('.root'):
+            try:
+                from libRHadronProductionSpikedRHadronAnalyzerPython import HitDumpReader
+                self.reader = HitDumpReader(file)
+            except ImportError:
+                pass
+
+    def events(self):
+        return list(self.index['Event'])
+
+    def summary(self, event):
+        #Index entry of the event: row count, energy per subdetector and Rhadron momenta
+        return self.index.iloc[self.rows[event]]
+
+    def hits(self, event):
+        #Hits of one event as a DataFrame with the columns of loadHits
+        entry = self.summary(event)
+        if self.reader is not None:
+            return pd.DataFrame(self.reader.hits(int(event)))
+        if self.file.endswith('.root'):
+            import uproot
+            df = uproot.open(self.file)['hits'].arrays(library='pd', entry_start=int(entry['Offset']),
+                                                       entry_stop=int(entry['Offset'] + entry['Rows']))
+            df = df.rename(columns=rootToCsvColumns)
+            df['Detector Type'] = pd.Categorical.from_codes(df.pop('subDetector'), subDetectorNames)
+            return df
+        import io
+        with open(self.file, 'rb') as csv:
+            header = csv.readline()
+            csv.seek(int(entry['Offset']))
+            rows = csv.read(int(entry['Bytes']))
+        return pd.read_csv(io.BytesIO(header + rows))
+
+
 def xyEventDisplay(df, x_scalefactor, y_scalefactor, g_mass, events=None, savefig=False):
     #Plots the xy locations of the CaloHits for each event, with arrows representing the Rhadron momenta. Calohit energies are scaled
     #by their size and color.
@@ -17,12 +133,16 @@ def xyEventDisplay(df, x_scalefactor, y_scalefactor, g_mass, events=None, savefi
     else:
         maxrange = events
 
+    #One pass over the hits, rather than one selection over the whole frame per event
+    eventHits = df.groupby('Event')
     for i in maxrange:
         if events is None:
             j = i+1
         else:
             j = i
-        event = df[df['Event'] == j]
+        if j not in eventHits.groups:
+            continue
+        event = eventHits.get_group(j)
         Rhad1_px = x_scalefactor * event['Rhad1_px [GeV]'].iloc[0]
         Rhad1_py = y_scalefactor * event['Rhad1_py [GeV]'].iloc[0]
         Rhad1_ET = (g_mass**2 + (Rhad1_px/x_scalefactor)**2 + (Rhad1_py/y_scalefactor)**2)**0.5
@@ -75,36 +195,20 @@ def hitLocations(df, energyCut=0):
 
 def nHitsInEvent(df, energyCut=0):
     #Returns the number of hits in each event with energy > energyCut.
+    counts = df[df['Calohit Energy [GeV]'] > energyCut].groupby('Event').size()
     nHits = []
     for i in range(max(df['Event'])):
-        event = df[df['Event'] == i+1]
-        nHits.append(len(event[event['Calohit Energy [GeV]'] > energyCut]))
-        if len(event[event['Calohit Energy [GeV]'] > energyCut]) == 4:
+        nHits.append(int(counts.get(i+1, 0)))
+        if nHits[-1] == 4:
             print(i+1)
     return nHits
 
 
-def nHitsAssociatedWithRHadron(df):
-    #Returns the number of hits associated with the Rhadrons in the dataset.
-    nHits = 0
-    nHitsFromRHadron = 0
-    for i in range(max(df['Event'])):
-        event = df[df['Event'] == i+1]
-        Rhad1_px = event['Rhad1_px [GeV]'].iloc[0]
-        Rhad1_py = event['Rhad1_py [GeV]'].iloc[0]
-        Rhad1_theta = math.atan2(Rhad1_py, Rhad1_px)
-        Rhad2_px = event['Rhad2_px [GeV]'].iloc[0]
-        Rhad2_py = event['Rhad2_py [GeV]'].iloc[0]
-        Rhad2_theta = math.atan2(Rhad2_py, Rhad2_px)
-       
-        hits = event[(event['Calohit Energy [GeV]'] > 1000)]
-        for index, row in hits.iterrows():
-            hit_theta = math.atan2(row['Calohit Y [cm]'], row['Calohit X [cm]'])
-            if abs(hit_theta - Rhad1_theta) < 0.1 or abs(hit_theta - Rhad2_theta) < 0.1:
-                nHitsFromRHadron += 1
-            nHits += 1
-        
-    return nHits, nHitsFromRHadron
+def nHitsAssociatedWithRHadron(df, energyCut=1000):
+    #Returns the number of hits above energyCut and how many of them descend from one of the Rhadrons.
+    #The association is the truth tag written by the analyzer in the 'R-hadron' column (1, 2 or 0 for none).
+    hits = df[df['Energy Deposit'] > energyCut]
+    return len(hits), int((hits['R-hadron'] > 0).sum())
 
 
 def removeMuonHits(df):
@@ -119,8 +223,9 @@ def removeECALHits(df):
 
 def analyzeVertices(df, energy=(1800.97,1800.99)):
     # Prepare data for plotting
-    df = df[(df['Calo Hit Energy [GeV]'] >= energy[0]) & (df['Calo Hit Energy [GeV]'] <= energy[1])]
-    interactionCounts = df.groupby(df['Parent'].abs())['Daughters'].value_counts()
+    # The parent of each hit's track is the 'Parent PDG' column, the hit's own track is the daughter
+    df = df[(df['Energy Deposit'] >= energy[0]) & (df['Energy Deposit'] <= energy[1])]
+    interactionCounts = df.groupby(df['Parent PDG'].abs())['PDG'].value_counts()
     parents = []
     daughters = []
     for i, v in interactionCounts.items():
@@ -310,7 +415,7 @@ def lowEnergyRHadHistogram(df):
 
 
 file = 'Gluino1800GeV_Hits.csv'
-df = pd.read_csv(file)
+df = loadHits(file)
 #x_scalefactor, y_scalefactor = 125 / max(max(df['Rhad1_px [GeV]']), max(df['Rhad2_px [GeV]'])), 125 / max(max(df['Rhad1_py [GeV]']), max(df['Rhad2_py [GeV]']))
 #g_mass = 1800
 
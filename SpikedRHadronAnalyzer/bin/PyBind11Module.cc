@@ -0,0 +1,98 @@
+// Python bindings of the hit dump reader, imported as libRHadronProductionSpikedRHadronAnalyzerPython from
+// the library directory of the CMSSW area. They are built as a library of their own, so the core library that
+// cmsRun loads does not link against Python 3. Columns are returned as numpy arrays keyed by the CSV column
+// names, so pandas.DataFrame(reader.hits(event)) gives the same frame as RhadronAnalysis.loadHits.
+
+#include <string>
+#include <vector>
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitDumpReader.h"
+
+namespace py = pybind11;
+
+namespace {
+  template <typename T>
+  py::array_t<T> toArray(const std::vector<T>& values) {
+    return py::array_t<T>(values.size(), values.data());
+  }
+
+  py::dict indexColumns(const HitDumpReader& reader) {
+    const std::size_t n = reader.size();
+    std::vector<std::uint64_t> event(n), offset(n), bytes(n), rows(n);
+    std::vector<std::vector<float>> energy(kHitIndexDetectors, std::vector<float>(n));
+    std::vector<std::vector<float>> momentum(8, std::vector<float>(n));
+    for (std::size_t i = 0; i < n; ++i) {
+      const HitIndexEntry& entry = reader.entry(i);
+      event[i] = entry.event;
+      offset[i] = entry.offset;
+      bytes[i] = entry.bytes;
+      rows[i] = entry.rows;
+      for (std::size_t d = 0; d < kHitIndexDetectors; ++d)
+        energy[d][i] = entry.energy[d];
+      for (std::size_t c = 0; c < 8; ++c)
+        momentum[c][i] = entry.rHadronMomentum[c / 4][c % 4];
+    }
+
+    py::dict columns;
+    columns["Event"] = toArray(event);
+    columns["Offset"] = toArray(offset);
+    columns["Bytes"] = toArray(bytes);
+    columns["Rows"] = toArray(rows);
+    const char* energyNames[kHitIndexDetectors] = {"Tracker Energy", "ECAL Energy", "HCAL Energy", "Muon Energy"};
+    for (std::size_t d = 0; d < kHitIndexDetectors; ++d)
+      columns[energyNames[d]] = toArray(energy[d]);
+    const char* momentumNames[8] = {"Rhad1_px [GeV]", "Rhad1_py [GeV]", "Rhad1_pz [GeV]", "Rhad1_E [GeV]",
+                                    "Rhad2_px [GeV]", "Rhad2_py [GeV]", "Rhad2_pz [GeV]", "Rhad2_E [GeV]"};
+    for (std::size_t c = 0; c < 8; ++c)
+      columns[momentumNames[c]] = toArray(momentum[c]);
+    return columns;
+  }
+
+  py::dict hitColumns(const HitDumpReader& reader, std::uint64_t event) {
+    HitColumns hits;
+    bool found;
+    {
+      py::gil_scoped_release release;
+      found = reader.hits(event, hits);
+    }
+    if (!found)
+      throw py::key_error("No event " + std::to_string(event));
+    py::dict columns;
+    columns["Event"] = toArray(std::vector<std::uint64_t>(hits.size(), event));
+    columns["Energy Deposit"] = toArray(hits.energy);
+    columns["x [cm]"] = toArray(hits.x);
+    columns["y [cm]"] = toArray(hits.y);
+    columns["z [cm]"] = toArray(hits.z);
+    columns["r [cm]"] = toArray(hits.r);
+    columns["PDG"] = toArray(hits.pdg);
+    columns["Track Energy"] = toArray(hits.trackEnergy);
+    columns["px"] = toArray(hits.px);
+    columns["py"] = toArray(hits.py);
+    columns["pz"] = toArray(hits.pz);
+    columns["Parent PDG"] = toArray(hits.parentPdg);
+    columns["R-hadron"] = toArray(hits.rHadron);
+    return columns;
+  }
+}
+
+PYBIND11_MODULE(libRHadronProductionSpikedRHadronAnalyzerPython, m) {
+  m.doc() = "Random access to SpikedRHadronAnalyzer CSV hit dumps through their .idx index";
+
+  py::class_<HitDumpReader>(m, "HitDumpReader")
+      .def(py::init<const std::string&>(), py::arg("fileName"))
+      .def("__len__", &HitDumpReader::size)
+      .def("__contains__", [](const HitDumpReader& reader, std::uint64_t event) { return reader.find(event) != nullptr; })
+      .def("index", &indexColumns, "Index entries as columns: offsets, row counts, energy per subdetector and R-hadron momenta")
+      .def(
+          "rows",
+          [](const HitDumpReader& reader, std::uint64_t event) {
+            const std::string_view rows = reader.rows(event);
+            return py::bytes(rows.data(), rows.size());
+          },
+          py::arg("event"),
+          "CSV rows of the event, empty if the file has no such event")
+      .def("hits", &hitColumns, py::arg("event"), "Hits of the event as columns, raises KeyError if the file has no such event");
+}
@@ -0,0 +1,439 @@
+// -*- C++ -*-
+//
+// Package:    SpikedRHadronAnalyzer
+// Program:    spikedCompareHistograms
+//
+/**\file compareHistograms.cc
+
+ Description: [Compares the histograms of N ROOT files against a reference file in one batch pass]
+
+ Implementation:
+     [Every file is read on its own thread. The matching histograms are copied into memory and the file is
+      closed, so no thread touches another file. For every histogram path found in the reference the KS
+      probability, the chi2 probability and the integral ratio of each other file are computed. One PDF page
+      per path is drawn on a single reused canvas, and the numbers are written to a JSON summary.
+      Replaces the comparisonPlots.cc macro, which compared two fixed files:
+        spikedCompareHistograms -o comparison -p 'HSCParticleAnalyzer/BaseName/CutFlow' \
+          -p 'HSCParticleAnalyzer/BaseName/PostPreS_Mass' evap.root:v5-Evap v3.root:v3]
+*/
+
+#include <fnmatch.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TCanvas.h"
+#include "TClass.h"
+#include "TColor.h"
+#include "TDirectory.h"
+#include "TFile.h"
+#include "TH1.h"
+#include "TH2.h"
+#include "TKey.h"
+#include "TLegend.h"
+#include "TPaveText.h"
+#include "TROOT.h"
+#include "TStyle.h"
+
+namespace {
+
+  struct Options {
+    std::vector<std::string> files;
+    std::vector<std::string> labels;
+    std::vector<std::string> patterns;
+    std::vector<std::string> logyPatterns;
+    std::string output = "comparison";
+    unsigned int reference = 0;
+    unsigned int threads = 0;
+    double threshold = 0.01;
+    bool normalize = false;
+    bool failIncompatible = false;
+  };
+
+  struct InputFile {
+    std::string label;
+    std::string error;
+    std::map<std::string, std::unique_ptr<TH1>> histograms;  // by path inside the file
+  };
+
+  struct Comparison {
+    double ks = std::numeric_limits<double>::quiet_NaN();
+    double chi2Probability = std::numeric_limits<double>::quiet_NaN();
+    double chi2 = std::numeric_limits<double>::quiet_NaN();
+    int ndf = 0;
+    double integralRatio = std::numeric_limits<double>::quiet_NaN();
+    bool found = false;
+    bool compatible = false;
+  };
+
+  void usage() {
+    std::cerr
+        << "Usage: spikedCompareHistograms [options] file[:label] file[:label] ...\n"
+           "  -p PATTERN   histogram paths to compare, glob on the path inside the file, repeatable (default all)\n"
+           "  -o PREFIX    writes PREFIX.pdf and PREFIX.json (default comparison)\n"
+           "  -r INDEX     reference file, counted from 0 (default 0)\n"
+           "  -j THREADS   files read in parallel (default one per core)\n"
+           "  -t PVALUE    KS and chi2 probabilities below it mark a histogram incompatible (default 0.01)\n"
+           "  -l PATTERN   paths drawn with a log y axis, repeatable\n"
+           "  -n           draw every histogram normalised to the reference integral\n"
+           "  -f           exit with status 2 if any histogram is incompatible or missing\n";
+  }
+
+  bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg = argv[i];
+      auto value = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+      if (arg == "-h" || arg == "--help") {
+        return false;
+      } else if (arg == "-p" || arg == "-o" || arg == "-r" || arg == "-j" || arg == "-t" || arg == "-l") {
+        const char* v = value();
+        if (!v) {
+          std::cerr << "missing value of " << arg << "\n";
+          return false;
+        }
+        if (arg == "-p")
+          options.patterns.emplace_back(v);
+        else if (arg == "-o")
+          options.output = v;
+        else if (arg == "-r")
+          options.reference = std::strtoul(v, nullptr, 10);
+        else if (arg == "-j")
+          options.threads = std::strtoul(v, nullptr, 10);
+        else if (arg == "-t")
+          options.threshold = std::strtod(v, nullptr);
+        else
+          options.logyPatterns.emplace_back(v);
+      } else if (arg == "-n") {
+        options.normalize = true;
+      } else if (arg == "-f") {
+        options.failIncompatible = true;
+      } else if (!arg.empty() && arg[0] == '-') {
+        std::cerr << "unknown option " << arg << "\n";
+        return false;
+      } else {
+        // file:label, the label is optional and may not contain '/' so urls like root://host//file keep their colons
+        const auto colon = arg.rfind(':');
+        if (colon != std::string::npos && arg.find('/', colon) == std::string::npos && colon + 1 < arg.size()) {
+          options.files.push_back(arg.substr(0, colon));
+          options.labels.push_back(arg.substr(colon + 1));
+        } else {
+          options.files.push_back(arg);
+          std::string label = arg.substr(arg.rfind('/') + 1);
+          options.labels.push_back(label.substr(0, label.rfind(".root")));
+        }
+      }
+    }
+    if (options.files.size() < 2) {
+      std::cerr << "need at least two files\n";
+      return false;
+    }
+    if (options.reference >= options.files.size()) {
+      std::cerr << "reference index " << options.reference << " out of range\n";
+      return false;
+    }
+    if (options.patterns.empty())
+      options.patterns.emplace_back("*");
+    return true;
+  }
+
+  bool matches(const std::string& path, const std::vector<std::string>& patterns) {
+    for (const auto& pattern : patterns) {
+      if (fnmatch(pattern.c_str(), path.c_str(), 0) == 0)
+        return true;
+    }
+    return false;
+  }
+
+  void collect(TDirectory* directory,
+               const std::string& prefix,
+               const std::vector<std::string>& patterns,
+               std::map<std::string, std::unique_ptr<TH1>>& histograms) {
+    TIter next(directory->GetListOfKeys());
+    while (auto key = static_cast<TKey*>(next())) {
+      // Only the highest cycle of every name
+      if (directory->GetKey(key->GetName())->GetCycle() != key->GetCycle())
+        continue;
+      const std::string path = prefix + key->GetName();
+      const TClass* type = TClass::GetClass(key->GetClassName());
+      if (!type)
+        continue;
+      if (type->InheritsFrom(TDirectory::Class())) {
+        collect(directory->GetDirectory(key->GetName()), path + "/", patterns, histograms);
+      } else if (type->InheritsFrom(TH1::Class()) && matches(path, patterns)) {
+        std::unique_ptr<TH1> histogram(static_cast<TH1*>(key->ReadObj()));
+        histogram->SetDirectory(nullptr);
+        histograms.emplace(path, std::move(histogram));
+      }
+    }
+  }
+
+  void readFiles(const Options& options, std::vector<InputFile>& inputs) {
+    inputs.resize(options.files.size());
+    std::atomic<unsigned int> nextFile(0);
+    auto worker = [&]() {
+      for (unsigned int i = nextFile++; i < inputs.size(); i = nextFile++) {
+        inputs[i].label = options.labels[i];
+        std::unique_ptr<TFile> file(TFile::Open(options.files[i].c_str(), "READ"));
+        if (!file || file->IsZombie()) {
+          inputs[i].error = "cannot open " + options.files[i];
+          continue;
+        }
+        collect(file.get(), "", options.patterns, inputs[i].histograms);
+        file->Close();
+      }
+    };
+    unsigned int nThreads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    nThreads = std::min<unsigned int>(nThreads, inputs.size());
+    std::vector<std::thread> threads;
+    for (unsigned int t = 1; t < nThreads; ++t)
+      threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads)
+      thread.join();
+  }
+
+  Comparison compare(const TH1& reference, const TH1& other, double threshold) {
+    Comparison result;
+    result.found = true;
+    const double referenceIntegral = reference.Integral();
+    const double otherIntegral = other.Integral();
+    if (referenceIntegral != 0.)
+      result.integralRatio = otherIntegral / referenceIntegral;
+    // Two empty histograms of the same binning agree, there is nothing to test
+    if (reference.GetNcells() == other.GetNcells() && referenceIntegral == 0. && otherIntegral == 0.) {
+      result.compatible = true;
+      return result;
+    }
+    if (reference.GetNcells() != other.GetNcells() || referenceIntegral <= 0. || otherIntegral <= 0.)
+      return result;
+    result.ks = reference.KolmogorovTest(&other);
+    // Weighted comparison as soon as one of them was filled with weights
+    const char* chi2Option = reference.GetSumw2N() || other.GetSumw2N() ? "WW NORM" : "UU NORM";
+    int igood = 0;
+    result.chi2Probability = reference.Chi2TestX(&other, result.chi2, result.ndf, igood, chi2Option);
+    result.compatible = result.ks >= threshold && (result.ndf == 0 || result.chi2Probability >= threshold);
+    return result;
+  }
+
+  std::string jsonString(const std::string& value) {
+    std::string out = "\"";
+    for (const char c : value) {
+      if (c == '"' || c == '\\')
+        out += '\\';
+      out += c;
+    }
+    return out + "\"";
+  }
+
+  std::string jsonNumber(double value) {
+    if (!std::isfinite(value))
+      return "null";
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+    return buffer;
+  }
+
+  int lineColor(unsigned int index) {
+    // The first two are the colours of comparisonPlots.cc
+    static const char* const colors[] = {
+        "#00A88F", "#BF2229", "#1F77B4", "#FF7F0E", "#9467BD", "#8C564B", "#E377C2", "#7F7F7F", "#BCBD22", "#17BECF"};
+    return TColor::GetColor(colors[index % (sizeof(colors) / sizeof(colors[0]))]);
+  }
+
+  void drawPage(TCanvas& canvas,
+                const std::string& path,
+                const std::vector<InputFile>& inputs,
+                const std::vector<Comparison>& comparisons,
+                const Options& options) {
+    canvas.Clear();
+    const TH1* reference = inputs[options.reference].histograms.at(path).get();
+    std::vector<std::unique_ptr<TH1>> drawn;  // copies, so normalising never changes the compared histograms
+
+    if (reference->GetDimension() > 1) {
+      // One pad per file for 2D histograms
+      const int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(inputs.size()))));
+      const int rows = (static_cast<int>(inputs.size()) + columns - 1) / columns;
+      canvas.Divide(columns, rows);
+      for (unsigned int i = 0; i < inputs.size(); ++i) {
+        const auto found = inputs[i].histograms.find(path);
+        if (found == inputs[i].histograms.end())
+          continue;
+        canvas.cd(i + 1);
+        drawn.emplace_back(static_cast<TH1*>(found->second->Clone()));
+        drawn.back()->SetStats(0);
+        drawn.back()->SetTitle((inputs[i].label + ": " + path).c_str());
+        drawn.back()->Draw("COLZ");
+      }
+    } else {
+      canvas.cd();
+      gPad->SetLogy(matches(path, options.logyPatterns));
+      TLegend legend(0.55, 0.70, 0.88, 0.88);
+      legend.SetBorderSize(0);
+      legend.SetTextSize(0.03);
+      double maximum = 0.;
+      for (unsigned int i = 0; i < inputs.size(); ++i) {
+        const auto found = inputs[i].histograms.find(path);
+        if (found == inputs[i].histograms.end())
+          continue;
+        drawn.emplace_back(static_cast<TH1*>(found->second->Clone()));
+        TH1* histogram = drawn.back().get();
+        const double integral = histogram->Integral();
+        if (options.normalize && integral > 0.)
+          histogram->Scale(reference->Integral() / integral);
+        histogram->SetStats(0);
+        histogram->SetLineColor(lineColor(i));
+        histogram->SetLineWidth(2);
+        maximum = std::max(maximum, histogram->GetMaximum());
+        legend.AddEntry(histogram, Form("%s (Integral: %.0f)", inputs[i].label.c_str(), integral), "l");
+      }
+      for (unsigned int i = 0; i < drawn.size(); ++i) {
+        drawn[i]->SetMaximum(gPad->GetLogy() ? maximum * 5. : maximum * 1.2);
+        drawn[i]->SetTitle(path.c_str());
+        drawn[i]->Draw(i == 0 ? "HIST" : "HIST SAME");
+      }
+      legend.DrawClone();
+    }
+
+    canvas.cd(0);
+    TPaveText statistics(0.12, 0.70, 0.50, 0.88, "NDC");
+    statistics.SetBorderSize(0);
+    statistics.SetFillStyle(0);
+    statistics.SetTextAlign(12);
+    statistics.SetTextSize(0.025);
+    for (unsigned int i = 0; i < inputs.size(); ++i) {
+      if (i == options.reference)
+        continue;
+      const Comparison& c = comparisons[i];
+      if (!c.found)
+        statistics.AddText(Form("%s: missing", inputs[i].label.c_str()));
+      else
+        statistics.AddText(Form("%s: KS %.3g, #chi^{2} p %.3g, ratio %.3g%s",
+                                inputs[i].label.c_str(),
+                                c.ks,
+                                c.chi2Probability,
+                                c.integralRatio,
+                                c.compatible ? "" : " #color[2]{incompatible}"));
+    }
+    statistics.DrawClone();
+    canvas.Print((options.output + ".pdf").c_str(), ("Title:" + path).c_str());
+  }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    usage();
+    return 1;
+  }
+
+  gROOT->SetBatch(true);
+  ROOT::EnableThreadSafety();
+  TH1::AddDirectory(false);
+
+  std::vector<InputFile> inputs;
+  readFiles(options, inputs);
+  bool failed = false;
+  for (const auto& input : inputs) {
+    if (!input.error.empty()) {
+      std::cerr << input.error << "\n";
+      failed = true;
+    }
+  }
+  if (failed)
+    return 1;
+
+  // Paths of the reference define the pages, paths only found elsewhere are reported as missing from the reference
+  const InputFile& reference = inputs[options.reference];
+  std::vector<std::string> onlyElsewhere;
+  for (unsigned int i = 0; i < inputs.size(); ++i) {
+    for (const auto& entry : inputs[i].histograms) {
+      if (!reference.histograms.count(entry.first) &&
+          std::find(onlyElsewhere.begin(), onlyElsewhere.end(), entry.first) == onlyElsewhere.end())
+        onlyElsewhere.push_back(entry.first);
+    }
+  }
+
+  gStyle->SetOptStat(0);
+  TCanvas canvas("comparison", "comparison", 800, 600);
+  canvas.Print((options.output + ".pdf[").c_str());
+
+  std::ofstream json(options.output + ".json");
+  json << "{\n  \"reference\": " << jsonString(reference.label) << ",\n  \"threshold\": " << jsonNumber(options.threshold)
+       << ",\n  \"files\": [";
+  for (unsigned int i = 0; i < inputs.size(); ++i)
+    json << (i ? ", " : "") << "{\"label\": " << jsonString(inputs[i].label) << ", \"file\": " << jsonString(options.files[i])
+         << "}";
+  json << "],\n  \"histograms\": [";
+
+  unsigned int nIncompatible = 0;
+  bool firstHistogram = true;
+  for (const auto& entry : reference.histograms) {
+    const std::string& path = entry.first;
+    std::vector<Comparison> comparisons(inputs.size());
+    bool compatible = true;
+    for (unsigned int i = 0; i < inputs.size(); ++i) {
+      if (i == options.reference)
+        continue;
+      const auto found = inputs[i].histograms.find(path);
+      if (found != inputs[i].histograms.end())
+        comparisons[i] = compare(*entry.second, *found->second, options.threshold);
+      compatible = compatible && comparisons[i].compatible;
+    }
+    nIncompatible += !compatible;
+    drawPage(canvas, path, inputs, comparisons, options);
+
+    json << (firstHistogram ? "" : ",") << "\n    {\"path\": " << jsonString(path)
+         << ", \"compatible\": " << (compatible ? "true" : "false") << ", \"integrals\": [";
+    firstHistogram = false;
+    for (unsigned int i = 0; i < inputs.size(); ++i) {
+      const auto found = inputs[i].histograms.find(path);
+      json << (i ? ", " : "")
+           << (found == inputs[i].histograms.end() ? "null" : jsonNumber(found->second->Integral()));
+    }
+    json << "], \"comparisons\": [";
+    bool firstComparison = true;
+    for (unsigned int i = 0; i < inputs.size(); ++i) {
+      if (i == options.reference)
+        continue;
+      const Comparison& c = comparisons[i];
+      json << (firstComparison ? "" : ", ") << "{\"label\": " << jsonString(inputs[i].label)
+           << ", \"found\": " << (c.found ? "true" : "false") << ", \"ks\": " << jsonNumber(c.ks)
+           << ", \"chi2\": " << jsonNumber(c.chi2) << ", \"ndf\": " << c.ndf
+           << ", \"chi2Probability\": " << jsonNumber(c.chi2Probability)
+           << ", \"integralRatio\": " << jsonNumber(c.integralRatio)
+           << ", \"compatible\": " << (c.compatible ? "true" : "false") << "}";
+      firstComparison = false;
+    }
+    json << "]}";
+  }
+  json << "\n  ],\n  \"missingFromReference\": [";
+  for (unsigned int i = 0; i < onlyElsewhere.size(); ++i)
+    json << (i ? ", " : "") << jsonString(onlyElsewhere[i]);
+  json << "]\n}\n";
+  json.close();
+
+  canvas.Print((options.output + ".pdf]").c_str());
+
+  std::cout << "Compared " << reference.histograms.size() << " histograms of " << inputs.size() << " files against "
+            << reference.label << ": " << nIncompatible << " incompatible or missing, " << onlyElsewhere.size()
+            << " not in the reference\n"
+            << "Wrote " << options.output << ".pdf and " << options.output << ".json\n";
+
+  if (reference.histograms.empty()) {
+    std::cerr << "no histogram of the reference matches the patterns\n";
+    return 1;
+  }
+  return options.failIncompatible && (nIncompatible > 0 || !onlyElsewhere.empty()) ? 2 : 0;
+}
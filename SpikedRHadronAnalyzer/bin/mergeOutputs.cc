@@ -0,0 +1,360 @@
+// -*- C++ -*-
+//
+// Package:    SpikedRHadronAnalyzer
+// Program:    spikedMergeOutputs
+//
+/**\file mergeOutputs.cc
+
+ Description: [Merges the per-job outputs of a production into one file per mass point and file type]
+
+ Implementation:
+     [Inputs are grouped by the M<mass>_CM<energy>_pythia8_jobNum<N>_<type>... names written by gensimToNTuple.sh,
+      files that do not follow it form one group named "merged". Every group is reduced as a tree: its files,
+      sorted by job number, are merged k at a time, then the results k at a time, until one file is left.
+      The merges of all groups and levels share one pool of threads, so the wall time follows the number of
+      cores and only grows with the logarithm of the number of files. Files keep their job-number order.
+      Flat ROOT files (NTuples, histograms) are merged with TFileMerger. EDM files (RECO, GEN-SIM) cannot be
+      hadd-ed, they are merged by cmsRun with python/mergeBlocks_cfg.py. The partial merges are always
+      deleted, the inputs only with -d once their group is complete.]
+*/
+
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TFile.h"
+#include "TFileMerger.h"
+#include "TROOT.h"
+
+namespace {
+
+  struct Options {
+    std::vector<std::string> inputs;
+    std::string outputDirectory = ".";
+    std::string mergeConfig;
+    unsigned int fanIn = 8;
+    unsigned int threads = 0;
+    bool deleteInputs = false;
+    bool dryRun = false;
+  };
+
+  struct Group {
+    std::string name;
+    std::vector<std::pair<long, std::string>> inputs;  // job number and file
+    bool edm = false;
+    std::vector<std::string> level;  // files of the level being merged, in order
+    unsigned int levelNumber = 0;
+    unsigned int pending = 0;  // merges of the current level still running
+    bool failed = false;
+  };
+
+  struct Task {
+    Group* group;
+    unsigned int index;  // position of the result in the next level
+    std::vector<std::string> files;
+    std::string output;
+  };
+
+  void usage() {
+    std::cerr << "Usage: spikedMergeOutputs [options] file|directory ...\n"
+                 "  -o DIR     directory of the merged files (default .)\n"
+                 "  -k FANIN   files per merge (default 8)\n"
+                 "  -j THREADS merges run in parallel (default one per core)\n"
+                 "  -l LIST    text file with one input per line, for more files than a command line holds\n"
+                 "  -c CFG     merge config of EDM files (default $CMSSW_BASE/src/RHadronProduction/SpikedRHadronAnalyzer/python/mergeBlocks_cfg.py)\n"
+                 "  -d         delete the inputs of a group once its merged file is written\n"
+                 "  -n         only print the groups\n";
+  }
+
+  bool endsWith(const std::string& value, const std::string& suffix) {
+    return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+  }
+
+  void addInput(const std::string& path, std::vector<std::string>& inputs) {
+    struct stat status;
+    if (stat(path.c_str(), &status) == 0 && S_ISDIR(status.st_mode)) {
+      if (DIR* directory = opendir(path.c_str())) {
+        while (const dirent* entry = readdir(directory)) {
+          const std::string name = entry->d_name;
+          if (endsWith(name, ".root") && name[0] != '.')
+            inputs.push_back(path + "/" + name);
+        }
+        closedir(directory);
+      }
+    } else {
+      inputs.push_back(path);
+    }
+  }
+
+  bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg = argv[i];
+      if (arg == "-h" || arg == "--help")
+        return false;
+      if (arg == "-d") {
+        options.deleteInputs = true;
+      } else if (arg == "-n") {
+        options.dryRun = true;
+      } else if (arg == "-o" || arg == "-k" || arg == "-j" || arg == "-l" || arg == "-c") {
+        if (i + 1 == argc) {
+          std::cerr << "missing value of " << arg << "\n";
+          return false;
+        }
+        const std::string value = argv[++i];
+        if (arg == "-o") {
+          options.outputDirectory = value;
+        } else if (arg == "-k") {
+          options.fanIn = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (arg == "-j") {
+          options.threads = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (arg == "-c") {
+          options.mergeConfig = value;
+        } else {
+          std::ifstream list(value);
+          if (!list) {
+            std::cerr << "cannot read " << value << "\n";
+            return false;
+          }
+          for (std::string line; std::getline(list, line);) {
+            if (!line.empty())
+              addInput(line, options.inputs);
+          }
+        }
+      } else if (!arg.empty() && arg[0] == '-') {
+        std::cerr << "unknown option " << arg << "\n";
+        return false;
+      } else {
+        addInput(arg, options.inputs);
+      }
+    }
+    if (options.fanIn < 2) {
+      std::cerr << "the fan-in must be at least 2\n";
+      return false;
+    }
+    if (options.inputs.empty()) {
+      std::cerr << "no input files\n";
+      return false;
+    }
+    if (options.mergeConfig.empty() && std::getenv("CMSSW_BASE"))
+      options.mergeConfig = std::string(std::getenv("CMSSW_BASE")) +
+                            "/src/RHadronProduction/SpikedRHadronAnalyzer/python/mergeBlocks_cfg.py";
+    return true;
+  }
+
+  std::vector<std::unique_ptr<Group>> makeGroups(const std::vector<std::string>& inputs) {
+    // M1800_CM13000_pythia8_jobNum12_recoM1800_1000Events.root -> M1800_CM13000_pythia8_reco
+    static const std::regex jobName(R"(^(M\d+_CM\d+_pythia8)_jobNum(\d+)_?(.*)\.root$)");
+    static const std::regex eventCount(R"(M\d+_\d+Events$)");
+    std::map<std::string, std::unique_ptr<Group>> groups;
+    for (const auto& input : inputs) {
+      const std::string fileName = input.substr(input.rfind('/') + 1);
+      std::smatch match;
+      std::string name = "merged";
+      long jobNumber = -1;
+      if (std::regex_match(fileName, match, jobName)) {
+        const std::string type = std::regex_replace(match[3].str(), eventCount, "");
+        name = match[1].str() + "_" + (type.empty() ? "merged" : type);
+        jobNumber = std::stol(match[2].str());
+      }
+      auto& group = groups[name];
+      if (!group) {
+        group = std::make_unique<Group>();
+        group->name = name;
+      }
+      group->inputs.emplace_back(jobNumber, input);
+    }
+    std::vector<std::unique_ptr<Group>> result;
+    for (auto& entry : groups) {
+      std::stable_sort(entry.second->inputs.begin(), entry.second->inputs.end());
+      result.push_back(std::move(entry.second));
+    }
+    return result;
+  }
+
+  bool isEdmFile(const std::string& fileName) {
+    std::unique_ptr<TFile> file(TFile::Open(fileName.c_str(), "READ"));
+    return file && !file->IsZombie() && file->Get("MetaData") && file->Get("ParameterSets");
+  }
+
+  bool mergeFlat(const Task& task) {
+    TFileMerger merger(false, false);
+    merger.SetPrintLevel(0);
+    if (!merger.OutputFile(task.output.c_str(), "RECREATE"))
+      return false;
+    for (const auto& file : task.files) {
+      if (!merger.AddFile(file.c_str(), false))
+        return false;
+    }
+    return merger.Merge();
+  }
+
+  bool mergeEdm(const Task& task, const std::string& config) {
+    std::string inputs;
+    for (const auto& file : task.files)
+      inputs += (inputs.empty() ? "file:" : ",file:") + file;
+    const std::string log = task.output + ".log";
+    const std::string command =
+        "cmsRun " + config + " inputFiles=" + inputs + " outputFile=" + task.output + " > " + log + " 2>&1";
+    const bool ok = std::system(command.c_str()) == 0;
+    if (ok)
+      std::remove(log.c_str());
+    else
+      std::cerr << task.group->name << ": cmsRun merge failed, see " << log << "\n";
+    return ok;
+  }
+
+  class Reducer {
+  public:
+    Reducer(const Options& options, std::vector<std::unique_ptr<Group>>& groups)
+        : options_(options), groups_(groups), open_(groups.size()) {}
+
+    bool run() {
+      for (auto& group : groups_) {
+        group->level.clear();
+        for (const auto& input : group->inputs)
+          group->level.push_back(input.second);
+        scheduleLevel(*group);
+      }
+      unsigned int nThreads = options_.threads ? options_.threads : std::max(1u, std::thread::hardware_concurrency());
+      std::vector<std::thread> threads;
+      for (unsigned int t = 1; t < nThreads; ++t)
+        threads.emplace_back([this] { work(); });
+      work();
+      for (auto& thread : threads)
+        thread.join();
+      bool ok = true;
+      for (const auto& group : groups_)
+        ok = ok && !group->failed;
+      return ok;
+    }
+
+  private:
+    // Splits the current level of a group into merges of fanIn files, the last level writes the final file.
+    // Called with the lock held, or before the threads start.
+    void scheduleLevel(Group& group) {
+      const unsigned int nMerges = (group.level.size() + options_.fanIn - 1) / options_.fanIn;
+      const bool last = nMerges == 1;
+      group.pending = nMerges;
+      for (unsigned int i = 0; i < nMerges; ++i) {
+        Task task;
+        task.group = &group;
+        task.index = i;
+        const auto first = group.level.begin() + i * options_.fanIn;
+        task.files.assign(first, first + std::min<size_t>(options_.fanIn, group.level.end() - first));
+        task.output = options_.outputDirectory + "/." + group.name + "_level" + std::to_string(group.levelNumber) + "_" +
+                      std::to_string(i) + ".root";
+        if (last)
+          task.output = options_.outputDirectory + "/." + group.name + ".root.part";
+        tasks_.push_back(std::move(task));
+      }
+      group.level.assign(nMerges, std::string());
+    }
+
+    void work() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (true) {
+        ready_.wait(lock, [this] { return !tasks_.empty() || open_ == 0; });
+        if (tasks_.empty())
+          return;
+        Task task = std::move(tasks_.front());
+        tasks_.pop_front();
+        lock.unlock();
+
+        const bool ok = task.group->edm ? mergeEdm(task, options_.mergeConfig) : mergeFlat(task);
+        // Partial merges of the previous level are not needed any more, the inputs are kept
+        if (task.group->levelNumber > 0) {
+          for (const auto& file : task.files)
+            std::remove(file.c_str());
+        }
+
+        lock.lock();
+        Group& group = *task.group;
+        group.level[task.index] = task.output;
+        group.failed = group.failed || !ok;
+        if (--group.pending == 0)
+          finishLevel(group);
+        ready_.notify_all();
+      }
+    }
+
+    void finishLevel(Group& group) {
+      if (group.failed) {
+        for (const auto& file : group.level)
+          std::remove(file.c_str());
+        std::cerr << group.name << ": merge failed, inputs kept\n";
+        --open_;
+        return;
+      }
+      if (group.level.size() > 1) {
+        ++group.levelNumber;
+        scheduleLevel(group);
+        return;
+      }
+      const std::string output = options_.outputDirectory + "/" + group.name + ".root";
+      if (std::rename(group.level.front().c_str(), output.c_str()) != 0) {
+        std::cerr << group.name << ": cannot write " << output << "\n";
+        group.failed = true;
+      } else {
+        std::cout << group.name << ": " << group.inputs.size() << " files merged into " << output << "\n";
+        if (options_.deleteInputs) {
+          for (const auto& input : group.inputs)
+            std::remove(input.second.c_str());
+        }
+      }
+      --open_;
+    }
+
+    const Options& options_;
+    std::vector<std::unique_ptr<Group>>& groups_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<Task> tasks_;
+    unsigned int open_;  // groups not finished yet
+  };
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    usage();
+    return 1;
+  }
+
+  gROOT->SetBatch(true);
+  ROOT::EnableThreadSafety();
+
+  auto groups = makeGroups(options.inputs);
+  for (auto& group : groups) {
+    group->edm = isEdmFile(group->inputs.front().second);
+    std::cout << group->name << ": " << group->inputs.size() << (group->edm ? " EDM" : " flat") << " files\n";
+  }
+  if (options.dryRun)
+    return 0;
+
+  bool edm = false;
+  for (const auto& group : groups)
+    edm = edm || group->edm;
+  if (edm && access(options.mergeConfig.c_str(), R_OK) != 0) {
+    std::cerr << "EDM files need the merge config, not found at '" << options.mergeConfig << "', use -c\n";
+    return 1;
+  }
+
+  Reducer reducer(options, groups);
+  return reducer.run() ? 0 : 1;
+}
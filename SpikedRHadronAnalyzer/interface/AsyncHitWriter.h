@@ -0,0 +1,80 @@
+#ifndef RHadronProduction_SpikedRHadronAnalyzer_AsyncHitWriter_h
+#define RHadronProduction_SpikedRHadronAnalyzer_AsyncHitWriter_h
+
+/**\class AsyncHitWriter AsyncHitWriter.h RHadronProduction/SpikedRHadronAnalyzer/interface/AsyncHitWriter.h
+
+ Description: [Runs a HitWriter on a dedicated thread so the event loop never waits on the output file]
+
+ Implementation:
+     [Streams take an EventRecord from a pool, fill it and push it back. push() serialises the
+      record on the calling stream and hands it to the writer thread over a BoundedQueue. The
+      writer thread returns the record to the pool once it is written. Pooled records keep their
+      capacity, so steady-state events do not allocate. When the queue is full, push() waits for
+      the writer thread to catch up. This is the backpressure that bounds the memory held by
+      pending events, and every wait is counted. close() drains the queue, joins the thread and
+      closes the writer. Exceptions thrown on the writer thread are rethrown there.
+      The records only travel through the lock-free queues. A side with nothing to do, the writer
+      on an empty queue or a stream on a full one, sleeps on a condition variable instead. It
+      announces itself in an atomic before re-checking the queue under the mutex, and the other
+      side only takes the mutex to notify when it sees that announcement, so the busy path never
+      locks.]
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/BoundedQueue.h"
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitWriter.h"
+
+class AsyncHitWriter {
+public:
+  // queueSize is the number of events that can wait for the writer thread
+  AsyncHitWriter(std::unique_ptr<HitWriter> writer, std::size_t queueSize);
+  ~AsyncHitWriter();
+
+  AsyncHitWriter(const AsyncHitWriter&) = delete;
+  AsyncHitWriter& operator=(const AsyncHitWriter&) = delete;
+
+  // Returns an empty record, reused from the pool when one is available
+  std::unique_ptr<EventRecord> acquire();
+
+  // Serialises the record on the calling thread and queues it, waits only while the queue is full.
+  // Returns the size of the event, see EventRecord::bytes().
+  std::size_t push(std::unique_ptr<EventRecord> record);
+
+  // Writes the pending events and closes the output
+  void close();
+
+  // Number of times push() had to wait for the writer thread
+  std::size_t stalls() const { return stalls_.load(std::memory_order_relaxed); }
+
+private:
+  void run();
+  void release(EventRecord* record);
+  void waitForRecords();
+  void wakeWriter();
+  void wakePushers();
+
+  std::unique_ptr<HitWriter> writer_;
+  BoundedQueue<EventRecord*> pending_;
+  BoundedQueue<EventRecord*> pool_;
+
+  std::atomic<bool> closing_{false};
+  std::atomic<std::size_t> stalls_{0};
+
+  // Sleeping writer and streams, see the class description
+  std::mutex mutex_;
+  std::condition_variable recordsQueued_;  // pending_ got a record or closing_ was set
+  std::condition_variable spaceFreed_;     // a record left pending_
+  std::atomic<bool> writerWaiting_{false};
+  std::atomic<unsigned int> pushersWaiting_{0};
+  std::exception_ptr error_;  // set by the writer thread, read after it is joined
+  std::thread thread_;
+};
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef RHadronProduction_SpikedRHadronAnalyzer_BoundedQueue_h
+#define RHadronProduction_SpikedRHadronAnalyzer_BoundedQueue_h
+
+/**\class BoundedQueue BoundedQueue.h RHadronProduction/SpikedRHadronAnalyzer/interface/BoundedQueue.h
+
+ Description: [Fixed-capacity lock-free queue used to hand events from the streams to the output thread]
+
+ Implementation:
+     [Ring buffer with a sequence number per cell (D. Vyukov's bounded MPMC queue). Producers and
+      consumers each claim a cell with one compare-and-swap on their own counter, so neither side
+      takes a lock. try_push fails when the queue is full and try_pop when it is empty, leaving the
+      waiting policy to the caller. The capacity is rounded up to a power of two.]
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+template <typename T>
+class BoundedQueue {
+public:
+  explicit BoundedQueue(std::size_t capacity) {
+    std::size_t size = 2;
+    while (size < capacity)
+      size *= 2;
+    mask_ = size - 1;
+    cells_.reset(new Cell[size]);
+    for (std::size_t i = 0; i < size; ++i)
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  bool try_push(T value) {
+    std::size_t position = enqueue_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[position & mask_];
+      const std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      const std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+      if (difference == 0) {
+        if (enqueue_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+          break;
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = enqueue_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->value = std::move(value);
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool try_pop(T& value) {
+    std::size_t position = dequeue_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[position & mask_];
+      const std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      const std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+      if (difference == 0) {
+        if (dequeue_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+          break;
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = dequeue_.load(std::memory_order_relaxed);
+      }
+    }
+    value = std::move(cell->value);
+    cell->sequence.store(position + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  // True when try_pop would fail. Exact only on the single consumer thread, a push still in progress counts as absent.
+  bool empty() const {
+    const std::size_t position = dequeue_.load(std::memory_order_relaxed);
+    return cells_[position & mask_].sequence.load(std::memory_order_acquire) != position + 1;
+  }
+
+  std::size_t capacity() const { return mask_ + 1; }
+
+private:
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  std::size_t mask_ = 0;
+
+  // Kept on separate cache lines so producers and the consumer do not invalidate each other
+  alignas(64) std::atomic<std::size_t> enqueue_{0};
+  alignas(64) std::atomic<std::size_t> dequeue_{0};
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef RHadronProduction_SpikedRHadronAnalyzer_CaloHitBuffer_h
+#define RHadronProduction_SpikedRHadronAnalyzer_CaloHitBuffer_h
+
+/**\class CaloHitBuffer CaloHitBuffer.h RHadronProduction/SpikedRHadronAnalyzer/interface/CaloHitBuffer.h
+
+ Description: [Structure-of-arrays batch of the ECAL or HCAL hits of one event]
+
+ Implementation:
+     [Hits are staged in DetId order with their detId, energy and time, and the index of their cell.
+      Each cell is looked up once and staged with its position and response correction. The
+      corrections and the cell positions are then applied to the whole batch in one loop over
+      contiguous arrays, which the compiler can vectorize. The buffer is owned by a hit kernel in
+      the stream cache, so its capacity is reused from event to event.]
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct CaloHitBuffer {
+  // Position and response correction of a calorimeter cell, as found by a kernel traits class
+  struct Cell {
+    float x;
+    float y;
+    float z;
+    float r;
+    float respCorr;
+  };
+
+  // One entry per cell with hits in the event
+  std::vector<float> cellX;
+  std::vector<float> cellY;
+  std::vector<float> cellZ;
+  std::vector<float> cellR;
+  std::vector<float> cellRespCorr;
+
+  // One entry per hit, in DetId order. x, y, z and r are filled by applyCorrections.
+  std::vector<std::uint32_t> cell;
+  std::vector<std::uint32_t> detId;
+  std::vector<float> energy;
+  std::vector<float> time;  // ns, as simulated
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> z;
+  std::vector<float> r;
+
+  // Returns the index to stage the hits of the cell with
+  std::uint32_t addCell(const Cell& c) {
+    cellX.push_back(c.x);
+    cellY.push_back(c.y);
+    cellZ.push_back(c.z);
+    cellR.push_back(c.r);
+    cellRespCorr.push_back(c.respCorr);
+    return cellX.size() - 1;
+  }
+
+  void push_back(std::uint32_t cellIndex, std::uint32_t id, float e, float t) {
+    cell.push_back(cellIndex);
+    detId.push_back(id);
+    energy.push_back(e);
+    time.push_back(t);
+  }
+
+  // Scales the energies by the response correction of their cell and copies the cell positions
+  void applyCorrections();
+
+  void clear();
+  std::size_t size() const { return energy.size(); }
+};
+
+#endif
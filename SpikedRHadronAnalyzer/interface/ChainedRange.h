@@ -0,0 +1,99 @@
+#ifndef RHadronProduction_SpikedRHadronAnalyzer_ChainedRange_h
+#define RHadronProduction_SpikedRHadronAnalyzer_ChainedRange_h
+
+/**\class ChainedRange ChainedRange.h RHadronProduction/SpikedRHadronAnalyzer/interface/ChainedRange.h
+
+ Description: [Read-only view that iterates over several hit collections as if they were one]
+
+ Implementation:
+     [Only pointers to the event products are stored, in a fixed-size array, so building the view
+      neither copies hits nor allocates. Empty collections are skipped when they are appended, which
+      lets the iterator step to the next collection without checking for empty ones.]
+*/
+
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+template <typename T, std::size_t N>
+class ChainedRange {
+public:
+  using Collection = std::vector<T>;
+
+  class const_iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const_iterator() = default;
+
+    reference operator*() const { return *current_; }
+    pointer operator->() const { return current_; }
+
+    const_iterator& operator++() {
+      if (++current_ == last_)
+        enter(part_ + 1);
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator previous = *this;
+      ++(*this);
+      return previous;
+    }
+
+    bool operator==(const const_iterator& other) const { return current_ == other.current_; }
+    bool operator!=(const const_iterator& other) const { return current_ != other.current_; }
+
+  private:
+    friend class ChainedRange;
+
+    const_iterator(const ChainedRange* range, std::size_t part) : range_(range) { enter(part); }
+
+    void enter(std::size_t part) {
+      part_ = part;
+      if (part_ < range_->nParts_) {
+        current_ = range_->parts_[part_]->data();
+        last_ = current_ + range_->parts_[part_]->size();
+      } else {
+        current_ = nullptr;
+        last_ = nullptr;
+      }
+    }
+
+    const ChainedRange* range_ = nullptr;
+    std::size_t part_ = 0;
+    const T* current_ = nullptr;
+    const T* last_ = nullptr;
+  };
+
+  // The collection must outlive the view, which holds for products owned by the event
+  void append(const Collection& collection) {
+    if (!collection.empty() && nParts_ < N)
+      parts_[nParts_++] = &collection;
+  }
+
+  void clear() { nParts_ = 0; }
+
+  std::size_t size() const {
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < nParts_; ++i)
+      total += parts_[i]->size();
+    return total;
+  }
+
+  bool empty() const { return nParts_ == 0; }
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, nParts_); }
+
+private:
+  std::array<const Collection*, N> parts_{};
+  std::size_t nParts_ = 0;
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef RHadronProduction_SpikedRHadronAnalyzer_HitAggregator_h
+#define RHadronProduction_SpikedRHadronAnalyzer_HitAggregator_h
+
+/**\class HitAggregator HitAggregator.h RHadronProduction/SpikedRHadronAnalyzer/interface/HitAggregator.h
+
+ Description: [Reduces the hits of one event to compact summaries, written instead of the hits in outputMode "summary"]
+
+ Implementation:
+     [Three summaries are produced per event: the summed energy per DetId, a log-binned histogram
+      of hit energies per (PDG, subdetector), and an eta-phi energy grid per subdetector, since
+      tracker and muon energy losses are orders of magnitude below calorimeter deposits. The grids
+      are one pre-sized array indexed by subdetector and bin, only the grids of the subdetectors
+      with hits in the event are read out and cleared. DetIds and (PDG, subdetector) pairs are sparse, so they are sorted
+      instead of hashed: the DetId sums are taken over runs of sorted hits, and every histogram
+      present in the event gets energyBins consecutive counters in one array, found by binary
+      search over its sorted keys. One aggregator lives in each stream cache, its arrays keep their
+      capacity between events. Only non-empty bins are emitted, DetIds in increasing order.]
+*/
+
+#include <cstdint>
+#include <vector>
+
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitColumns.h"
+
+struct EventSummary {
+  // Summed energy per DetId
+  std::vector<std::uint32_t> detId;
+  std::vector<std::uint8_t> detIdSubDetector;
+  std::vector<float> detIdEnergy;
+
+  // Non-empty bins of the hit energy histograms, one histogram per (PDG, subdetector)
+  std::vector<std::int32_t> histogramPdg;
+  std::vector<std::uint8_t> histogramSubDetector;
+  std::vector<float> histogramEnergyLow;
+  std::vector<std::uint32_t> histogramCount;
+
+  // Non-empty cells of the eta-phi energy grids, at the cell centre, one grid per subdetector
+  std::vector<std::uint8_t> cellSubDetector;
+  std::vector<float> cellEta;
+  std::vector<float> cellPhi;
+  std::vector<float> cellEnergy;
+
+  void clear();
+  bool empty() const { return detId.empty(); }
+};
+
+class HitAggregator {
+public:
+  struct Config {
+    unsigned int etaBins = 50;
+    float etaMin = -5.f;
+    float etaMax = 5.f;
+    unsigned int phiBins = 72;
+    unsigned int energyBins = 50;
+    float energyMin = 1e-6f;  // GeV, lower edge of the first bin, smaller hits go to the first bin
+    float energyMax = 1e4f;   // GeV, upper edge of the last bin, larger hits go to the last bin
+  };
+
+  explicit HitAggregator(const Config& config);
+
+  // Replaces the content of summary with the summaries of hits
+  void fill(const HitColumns& hits, EventSummary& summary);
+
+  const Config& config() const { return config_; }
+
+private:
+  static std::uint64_t histogramKey(std::int32_t pdg, std::uint8_t subDetector);
+  unsigned int energyBin(float energy) const;
+
+  Config config_;
+  float logEnergyMin_;
+  float binsPerLogEnergy_;
+  float binsPerEta_;
+  float binsPerPhi_;
+
+  std::vector<std::uint64_t> keys_;              // DetId in the high word, hit in the low word
+  std::vector<std::uint64_t> histogramKeys_;     // (PDG, subdetector) of every histogram, sorted
+  std::vector<std::uint32_t> histogramCounts_;   // energyBins per histogram
+  std::vector<float> grid_;                      // kHitSubDetectors x etaBins x phiBins
+  std::uint32_t gridSubDetectors_ = 0;           // bit per subdetector with a non-empty grid
+};
+
+#endif
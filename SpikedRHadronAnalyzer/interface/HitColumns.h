@@ -0,0 +1,86 @@
+#ifndef RHadronProduction_SpikedRHadronAnalyzer_HitColumns_h
+#define RHadronProduction_SpikedRHadronAnalyzer_HitColumns_h
+
+/**\class HitColumns HitColumns.h RHadronProduction/SpikedRHadronAnalyzer/interface/HitColumns.h
+
+ Description: [Column-oriented storage of the hits written out for one event]
+
+ Implementation:
+     [One typed vector per output column, so writers can hand whole columns to the output format
+      instead of converting hit by hit. Positions and energies are stored as float32.]
+*/
+
+#include <cstdint>
+#include <vector>
+
+#include "DataFormats/DetId/interface/DetId.h"
+
+// Value of the subdetector column, Unknown is used for DetIds the analyzer does not handle
+enum class HitSubDetector : std::uint8_t {
+  Unknown = 0,
+  PixelBarrel,
+  PixelEndcap,
+  TIB,
+  TID,
+  TOB,
+  TEC,
+  EB,
+  EE,
+  ES,
+  HCAL,
+  MuonDT,
+  MuonCSC,
+  MuonRPC,
+  MuonGEM
+};
+constexpr std::size_t kHitSubDetectors = static_cast<std::size_t>(HitSubDetector::MuonGEM) + 1;
+
+HitSubDetector hitSubDetector(DetId detId);
+const char* hitSubDetectorName(HitSubDetector subDetector);
+
+// One output row, as filled by the subdetector loops
+struct HitRow {
+  float energy;
+  float x;
+  float y;
+  float z;
+  float r;
+  std::int32_t pdg;
+  float trackEnergy;
+  float px;
+  float py;
+  float pz;
+  HitSubDetector subDetector;
+  std::uint32_t detId;
+  std::int32_t parentPdg;  // PDG of the parent of the track, 0 for primaries
+  std::uint8_t rHadron;    // R-hadron (1 or 2) the track descends from, 0 for none
+};
+
+struct HitColumns {
+  std::vector<float> energy;
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> z;
+  std::vector<float> r;
+  std::vector<std::int32_t> pdg;
+  std::vector<float> trackEnergy;
+  std::vector<float> px;
+  std::vector<float> py;
+  std::vector<float> pz;
+  std::vector<std::uint8_t> subDetector;
+  std::vector<std::uint32_t> detId;
+  std::vector<std::int32_t> parentPdg;
+  std::vector<std::uint8_t> rHadron;
+
+  void push_back(const HitRow& row);
+  void reserve(std::size_t n);
+  void clear();
+
+  // Keeps the rows whose flag is non-zero, in their order. keep has one flag per row.
+  void select(const std::vector<std::uint8_t>& keep);
+
+  std::size_t size() const { return energy.size(); }
+  bool empty() const { return energy.empty(); }
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef RHadronProduction_SpikedRHadronAnalyzer_HitDumpReader_h
+#define RHadronProduction_SpikedRHadronAnalyzer_HitDumpReader_h
+
+/**\class HitDumpReader HitDumpReader.h RHadronProduction/SpikedRHadronAnalyzer/interface/HitDumpReader.h
+
+ Description: [Random access to the events of a CSV hit dump through its HitIndex]
+
+ Implementation:
+     [The CSV file and its "<file>.idx" are memory-mapped read-only. An event is found by binary
+      search over the index entries and its rows are parsed straight from the mapping, so reading one
+      event costs its own rows only. The index is refused when its layout or the recorded size of the
+      CSV file do not match. The mapping is shared by concurrent readers, all methods are const.
+      The detId and subdetector columns are not in the CSV file and are left 0 and Unknown.]
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitColumns.h"
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitIndex.h"
+
+class HitDumpReader {
+public:
+  // Throws a cms::Exception when the file or its index cannot be mapped or do not belong together
+  explicit HitDumpReader(const std::string& fileName);
+  ~HitDumpReader();
+
+  HitDumpReader(const HitDumpReader&) = delete;
+  HitDumpReader& operator=(const HitDumpReader&) = delete;
+
+  // Index entries, in the event-number order of the file
+  std::size_t size() const { return events_; }
+  const HitIndexEntry& entry(std::size_t i) const { return entries_[i]; }
+
+  // First entry of the event, nullptr if the file has no such event
+  const HitIndexEntry* find(std::uint64_t event) const;
+
+  // CSV rows of the event, empty if the file has no such event
+  std::string_view rows(std::uint64_t event) const;
+
+  // Rows of the event parsed into columns, hits is cleared first. Returns false if the file has no such event.
+  bool hits(std::uint64_t event, HitColumns& hits) const;
+
+private:
+  struct Mapping {
+    const char* data = nullptr;
+    std::size_t size = 0;
+  };
+
+  static Mapping map(const std::string& fileName);
+  static void unmap(Mapping& mapping);
+
+  std::string fileName_;
+  Mapping data_;
+  Mapping index_;
+  const HitIndexEntry* entries_ = nullptr;
+  std::size_t events_ = 0;
+};
+
+#endif
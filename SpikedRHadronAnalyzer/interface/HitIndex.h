@@ -0,0 +1,66 @@
+#ifndef RHadronProduction_SpikedRHadronAnalyzer_HitIndex_h
+#define RHadronProduction_SpikedRHadronAnalyzer_HitIndex_h
+
+/**\class HitIndexEntry HitIndex.h RHadronProduction/SpikedRHadronAnalyzer/interface/HitIndex.h
+
+ Description: [Sidecar index of a SpikedRHadronAnalyzer hit dump, one fixed-size entry per event]
+
+ Implementation:
+     [The index is written next to the hit output as "<file>.idx" in outputMode "hits". It is a
+      HitIndexHeader followed by one HitIndexEntry per event, in the event-number order of the hit
+      file. For CSV dumps the offset is the byte position of the first row of the event, for ROOT
+      dumps it is the first entry of the "hits" tree. Every entry also carries the summed energy per
+      subdetector group and the momenta of the two R-hadrons, so event selections can be made from
+      the index alone. The layout is little-endian with no padding, readable with a numpy dtype.]
+*/
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitColumns.h"
+
+// What HitIndexEntry::offset counts
+enum class HitIndexFormat : std::uint32_t { Csv = 0, Root = 1 };
+
+// Subdetector groups of the per-event energy sums
+enum class HitIndexDetector : std::uint8_t { Tracker = 0, Ecal, Hcal, Muon };
+constexpr std::size_t kHitIndexDetectors = 4;
+
+// Group of a subdetector, false for HitSubDetector::Unknown
+bool hitIndexDetector(HitSubDetector subDetector, HitIndexDetector& group);
+
+struct HitIndexHeader {
+  char magic[8];             // kHitIndexMagic
+  std::uint32_t entrySize;   // sizeof(HitIndexEntry), a file of another layout is refused
+  std::uint32_t format;      // HitIndexFormat
+  std::uint64_t events;
+  std::uint64_t dataSize;    // bytes of the CSV file or entries of the ROOT tree, to detect a stale index
+};
+
+struct HitIndexEntry {
+  std::uint64_t event;
+  std::uint64_t offset;      // first byte (CSV) or first tree entry (ROOT) of the event
+  std::uint64_t bytes;       // length of the rows of the event in the CSV file, 0 for ROOT
+  std::uint64_t rows;
+  std::array<float, kHitIndexDetectors> energy;          // GeV deposited, by HitIndexDetector
+  std::array<std::array<float, 4>, 2> rHadronMomentum;   // px, py, pz, E [GeV] of R-hadrons 1 and 2, 0 if absent
+};
+
+static_assert(sizeof(HitIndexHeader) == 32, "HitIndexHeader is read as a fixed layout");
+static_assert(sizeof(HitIndexEntry) == 80, "HitIndexEntry is read as a fixed layout");
+
+constexpr char kHitIndexMagic[8] = {'S', 'R', 'H', 'I', 'D', 'X', '1', '\0'};
+
+// "<dataFile>.idx"
+std::string hitIndexFileName(const std::string& dataFileName);
+
+// Writes the index of dataFileName, the entries must be in the order of the data file.
+// Throws a cms::Exception when the file cannot be written.
+void writeHitIndex(const std::string& dataFileName,
+                   HitIndexFormat format,
+                   std::uint64_t dataSize,
+                   const std::vector<HitIndexEntry>& entries);
+
+#endif
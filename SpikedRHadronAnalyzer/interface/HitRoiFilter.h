@@ -0,0 +1,57 @@
+#ifndef RHadronProduction_SpikedRHadronAnalyzer_HitRoiFilter_h
+#define RHadronProduction_SpikedRHadronAnalyzer_HitRoiFilter_h
+
+/**\class HitRoiFilter HitRoiFilter.h RHadronProduction/SpikedRHadronAnalyzer/interface/HitRoiFilter.h
+
+ Description: [Keeps the hits of an event that lie in a cone around the gen-level R-hadron directions, or above an energy threshold]
+
+ Implementation:
+     [The cone size is set per subdetector group (tracker, ECAL, HCAL, muon system), since the
+      deposits of an R-hadron spread differently in each. The filter works on the whole event in
+      two passes over contiguous float arrays: the first computes the eta and phi of every hit,
+      the second compares them with both directions. The second pass is branch-free arithmetic, a
+      missing R-hadron is a direction no hit can be close to, so the compiler vectorises it.
+      The surviving rows are then compacted in place. The per-hit eta, phi, cone and keep arrays
+      are members, so a filter reused for every event of a stream does not allocate once they
+      have grown.]
+*/
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitColumns.h"
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitIndex.h"
+
+class HitRoiFilter {
+public:
+  struct Config {
+    std::array<float, kHitIndexDetectors> cone{{0.5f, 0.5f, 0.5f, 0.5f}};  // Delta R, by HitIndexDetector
+    float energyThreshold = 0.f;  // GeV, hits at or above it are kept anywhere, 0 disables it
+  };
+
+  struct Direction {
+    float eta;
+    float phi;
+  };
+
+  explicit HitRoiFilter(const Config& config);
+
+  // Removes the hits outside every cone and below the threshold, returns the number removed.
+  // Takes up to two directions, an event with none keeps only the hits above the threshold.
+  std::size_t prune(HitColumns& hits, const Direction* directions, std::size_t nDirections);
+
+  const Config& config() const { return config_; }
+
+private:
+  Config config_;
+  float threshold_;                                     // infinite when disabled
+  std::array<float, 16> coneSquared_;                   // by HitSubDetector, 0 for Unknown
+  std::vector<float> eta_;
+  std::vector<float> phi_;
+  std::vector<float> coneSquaredOfHit_;
+  std::vector<std::uint8_t> keep_;
+};
+
+#endif
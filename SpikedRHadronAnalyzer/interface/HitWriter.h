@@ -0,0 +1,61 @@
+#ifndef RHadronProduction_SpikedRHadronAnalyzer_HitWriter_h
+#define RHadronProduction_SpikedRHadronAnalyzer_HitWriter_h
+
+/**\class HitWriter HitWriter.h RHadronProduction/SpikedRHadronAnalyzer/interface/HitWriter.h
+
+ Description: [Output format of the SpikedRHadronAnalyzer hit dump]
+
+ Implementation:
+     [Two formats are available. "csv" keeps the original text file. "root" writes a flat TTree
+      named "hits" with one typed branch per column. The file is opened when the writer is
+      created, so a bad output path fails at construction.
+      In mode "summary" only the per-event summaries of HitAggregator are written: three CSV files
+      suffixed _detIds, _histograms and _etaPhi, or three TTrees of the same names in one ROOT file.
+      Writing is split in two steps so it can be run by AsyncHitWriter. serialize() is const and is
+      called by the stream that produced the event. write() is called from one thread only, in the
+      order the events arrive. Events are appended to "<file>.part". close() renames it when the
+      events came in event-number order, otherwise it rewrites them sorted into the output file.
+      In mode "hits" close() also writes the HitIndex of the file as "<file>.idx".]
+*/
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitAggregator.h"
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitColumns.h"
+
+// Everything written for one event, the hits or their summaries depending on the mode
+struct EventRecord {
+  std::uint64_t event = 0;
+  HitColumns hits;
+  EventSummary summary;
+  std::array<std::array<float, 4>, 2> rHadronMomentum{};  // px, py, pz, E of R-hadrons 1 and 2, for the index
+  std::array<std::string, 3> text;  // serialised rows, one block per output file of the text formats
+
+  void clear();
+
+  // Size of the event as handed to the writer: the serialised text of the text formats, otherwise the uncompressed columns
+  std::size_t bytes() const;
+};
+
+class HitWriter {
+public:
+  virtual ~HitWriter() = default;
+
+  // Prepares the record for write(), may be called concurrently for different records
+  virtual void serialize(EventRecord&) const {}
+
+  // Appends one event
+  virtual void write(const EventRecord& record) = 0;
+
+  // Restores the event-number order, flushes and closes the output, no more events can be written afterwards
+  virtual void close() = 0;
+
+  // Throws a cms::Exception for unknown formats or modes, or files that cannot be opened
+  static std::unique_ptr<HitWriter> create(const std::string& format, const std::string& fileName, const std::string& mode = "hits");
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef RHadronProduction_SpikedRHadronAnalyzer_SimTrackIndex_h
+#define RHadronProduction_SpikedRHadronAnalyzer_SimTrackIndex_h
+
+/**\class SimTrackIndex SimTrackIndex.h RHadronProduction/SpikedRHadronAnalyzer/interface/SimTrackIndex.h
+
+ Description: [Per-event trackId -> SimTrack lookup shared by all subdetector hit loops]
+
+ Implementation:
+     [Geant4 track ids are mostly dense, so the index is a flat vector keyed by trackId. Events with
+      very sparse ids fall back to an open-addressing hash table. The storage is kept between events
+      so a stream only allocates when an event is larger than any it has seen before.]
+*/
+
+#include <cstdint>
+#include <vector>
+
+#include "SimDataFormats/Track/interface/SimTrack.h"
+#include "SimDataFormats/Track/interface/SimTrackContainer.h"
+
+class SimTrackIndex {
+public:
+  SimTrackIndex() = default;
+
+  // Index the tracks of one event, the container must outlive the lookups
+  void build(const edm::SimTrackContainer& tracks);
+
+  // Returns the first track with this id, or nullptr if the event has none
+  const SimTrack* find(unsigned int trackId) const {
+    const int slot = position(trackId);
+    return slot < 0 ? nullptr : &(*tracks_)[slot];
+  }
+
+  // Position of the track in the indexed container, or -1 if the event has none
+  int position(unsigned int trackId) const {
+    if (dense_)
+      return trackId < slots_.size() ? slots_[trackId] : -1;
+    return probe(trackId);
+  }
+
+  bool isDense() const { return dense_; }
+  std::size_t size() const { return tracks_ ? tracks_->size() : 0; }
+
+private:
+  int probe(unsigned int trackId) const;
+
+  static std::size_t hash(unsigned int trackId) { return static_cast<std::size_t>(trackId) * 0x9E3779B97F4A7C15ULL; }
+
+  const edm::SimTrackContainer* tracks_ = nullptr;
+  bool dense_ = true;
+
+  // Dense mode: slots_[trackId] is the track position. Sparse mode: keys_/slots_ form the hash table.
+  std::vector<int> slots_;
+  std::vector<unsigned int> keys_;
+  std::size_t mask_ = 0;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef RHadronProduction_SpikedRHadronAnalyzer_SimTruthGraph_h
+#define RHadronProduction_SpikedRHadronAnalyzer_SimTruthGraph_h
+
+/**\class SimTruthGraph SimTruthGraph.h RHadronProduction/SpikedRHadronAnalyzer/interface/SimTruthGraph.h
+
+ Description: [Per-event SimTrack parent graph, tags every track with the R-hadron it descends from and its parent PDG]
+
+ Implementation:
+     [The graph is an adjacency array over the track positions of a SimTrackIndex: the parent of a
+      track is the track that produced its SimVertex. After the parents are filled, the top-most
+      R-hadron ancestor of each track is resolved once. Each walk stops at the first track that is
+      already resolved, and every track on the walk is memoised, so the whole event costs O(tracks).
+      The two top-most R-hadrons are numbered 1 and 2 in trackId order. Tracks that descend from
+      neither get 0. Lookups per hit are then array reads.]
+*/
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/SimTrackIndex.h"
+#include "SimDataFormats/Vertex/interface/SimVertexContainer.h"
+
+class SimTruthGraph {
+public:
+  SimTruthGraph() = default;
+
+  // Builds the graph of the tracks indexed by trackIndex, which must be built for the same event
+  void build(const SimTrackIndex& trackIndex, const edm::SimTrackContainer& tracks, const edm::SimVertexContainer& vertices);
+
+  // R-hadron (1 or 2) the track descends from, itself included, or 0 if none
+  std::uint8_t rHadron(unsigned int trackId) const {
+    const int slot = trackIndex_->position(trackId);
+    return slot < 0 ? 0 : rHadron_[slot];
+  }
+
+  // PDG of the track that produced this one, 0 for primaries and unknown tracks
+  std::int32_t parentPdg(unsigned int trackId) const {
+    const int slot = trackIndex_->position(trackId);
+    return slot < 0 ? 0 : parentPdg_[slot];
+  }
+
+  // Position in the SimTrack container of R-hadron 1 or 2, -1 when the event has fewer R-hadrons
+  int rHadronPosition(std::uint8_t rHadron) const { return rHadron == 1 || rHadron == 2 ? rHadronPosition_[rHadron - 1] : -1; }
+
+  // Gluino R-hadrons: the gluinoball 1000993, mesons 1009xxx and baryons 1091xxx to 1093xxx.
+  // Stop R-hadrons: mesons 1000612 to 1000652 and baryons 1006xxx. Other SUSY states are not R-hadrons.
+  static bool isRHadron(int pdg) {
+    const int absPdg = pdg < 0 ? -pdg : pdg;
+    const int family = absPdg / 1000;
+    return absPdg == 1000993 || family == 1009 || (family >= 1091 && family <= 1093) || family == 1006 ||
+           (absPdg / 100 == 10006 && absPdg % 10 == 2);
+  }
+
+private:
+  static constexpr int kUnresolved = -2;
+
+  const SimTrackIndex* trackIndex_ = nullptr;
+
+  // Indexed by track position, kept between events like the SimTrackIndex storage
+  std::vector<int> parent_;      // position of the parent track, -1 for none
+  std::vector<int> topRHadron_;  // position of the top-most R-hadron ancestor, -1 for none
+  std::vector<std::uint8_t> rHadron_;
+  std::vector<std::int32_t> parentPdg_;
+  std::vector<int> path_;
+  std::array<int, 2> rHadronPosition_{{-1, -1}};
+};
+
+#endif
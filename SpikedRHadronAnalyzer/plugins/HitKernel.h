@@ -0,0 +1,270 @@
+#ifndef RHadronProduction_SpikedRHadronAnalyzer_HitKernel_h
+#define RHadronProduction_SpikedRHadronAnalyzer_HitKernel_h
+
+/**\class HitKernel HitKernel.h
+
+ Description: [Turns the sim hits of one subdetector into output rows, one kernel shared by all subdetectors]
+
+ Implementation:
+     [The kernel is specialised at compile time by a traits class, which says how a hit type is
+      placed in its geometry. A traits class provides:
+        using Hit, Location;
+        static constexpr bool staged;
+        DetId detId(const Hit&, const RunGeometryCache&) const;                   DetId the geometry knows the hit by
+        bool locate(const RunGeometryCache&, DetId, Location&) const;             false drops every hit of the DetId
+        void place(const Location&, const Hit&, HitRow&) const;                   energy, x, y, z and r, unstaged traits only
+        unsigned int trackId(const Hit&) const;
+        HitSubDetector subDetector(DetId) const;
+      Hits are first sorted by DetId, so each detector unit or cell is looked up once per event and
+      the hits placed in it follow each other. Tracking hits are placed one row at a time. Staged
+      traits are the calorimeters, their Location is a CaloHitBuffer::Cell. Their hits go into a
+      CaloHitBuffer instead, which applies the response corrections and cell positions to the whole
+      event in one loop. The rows are then written in the order of the hits,
+      only for hits whose SimTrack is in the event. StreamBuffer owns one kernel per subdetector, so
+      the sort keys and the staged rows keep their capacity from one event to the next.]
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/CaloHitBuffer.h"
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitColumns.h"
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/SimTrackIndex.h"
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/SimTruthGraph.h"
+#include "RunGeometryCache.h"
+
+#include "DataFormats/DetId/interface/DetId.h"
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "Geometry/HcalCommonData/interface/HcalHitRelabeller.h"
+#include "SimDataFormats/CaloHit/interface/PCaloHit.h"
+#include "SimDataFormats/Track/interface/SimTrack.h"
+#include "SimDataFormats/TrackingHit/interface/PSimHit.h"
+
+template <typename Traits>
+class HitKernel {
+public:
+  using Hit = typename Traits::Hit;
+
+  explicit HitKernel(Traits traits = Traits()) : traits_(traits) {}
+
+  // Appends the rows of the hits in range to hits, returns the number of hits without a row
+  template <typename Range>
+  std::size_t process(const Range& range,
+                      const RunGeometryCache& geometry,
+                      const SimTrackIndex& trackIndex,
+                      const SimTruthGraph& truth,
+                      HitColumns& hits) {
+    // Sort keys hold the DetId in the high word and the position of the hit in the low word
+    hits_.clear();
+    keys_.clear();
+    for (const Hit& hit : range) {
+      const std::uint64_t rawId = traits_.detId(hit, geometry).rawId();
+      keys_.push_back(rawId << 32 | hits_.size());
+      hits_.push_back(&hit);
+    }
+    std::sort(keys_.begin(), keys_.end());
+
+    // One geometry lookup per DetId, the hits of that DetId are placed or staged straight after it
+    const std::size_t n = hits_.size();
+    if constexpr (Traits::staged)
+      stage(geometry);
+    else
+      place(geometry);
+
+    const std::size_t start = hits.size();
+    for (std::size_t i = 0; i < n; ++i) {
+      if (!placed_[i])
+        continue;
+
+      // Find the corresponding SimTrack
+      const unsigned int trackId = traits_.trackId(*hits_[i]);
+      const SimTrack* simTrack = trackIndex.find(trackId);
+      if (simTrack == nullptr)
+        continue;
+
+      // Staged hits take their corrected energy and position from the batch
+      HitRow& row = rows_[i];
+      if constexpr (Traits::staged) {
+        const std::uint32_t j = slot_[i];
+        row.energy = calo_.energy[j];
+        row.x = calo_.x[j];
+        row.y = calo_.y[j];
+        row.z = calo_.z[j];
+        row.r = calo_.r[j];
+        row.subDetector = cellSubDetector_[calo_.cell[j]];
+        row.detId = calo_.detId[j];
+      }
+
+      // Particle type and momentum of the particle that caused the hit
+      const auto& momentum = simTrack->momentum();
+      row.pdg = simTrack->type();
+      row.trackEnergy = momentum.E();
+      row.px = momentum.Px();
+      row.py = momentum.Py();
+      row.pz = momentum.Pz();
+      row.parentPdg = truth.parentPdg(trackId);
+      row.rHadron = truth.rHadron(trackId);
+      hits.push_back(row);
+    }
+    return n - (hits.size() - start);
+  }
+
+private:
+  // Fills the rows of the located hits one at a time
+  void place(const RunGeometryCache& geometry) {
+    rows_.resize(hits_.size());
+    placed_.assign(hits_.size(), 0);
+    typename Traits::Location location{};
+    bool found = false;
+    HitSubDetector subDetector = HitSubDetector::Unknown;
+    std::uint64_t current = ~std::uint64_t(0);
+    for (const std::uint64_t key : keys_) {
+      const std::uint32_t rawId = key >> 32;
+      if (rawId != current) {
+        current = rawId;
+        found = traits_.locate(geometry, DetId(rawId), location);
+        subDetector = traits_.subDetector(DetId(rawId));
+      }
+      if (!found)
+        continue;
+      const std::size_t i = key & 0xffffffff;
+      HitRow& row = rows_[i];
+      traits_.place(location, *hits_[i], row);
+      row.subDetector = subDetector;
+      row.detId = rawId;
+      placed_[i] = 1;
+    }
+  }
+
+  // Stages the located hits in the calorimeter buffer and corrects them as one batch
+  void stage(const RunGeometryCache& geometry) {
+    rows_.resize(hits_.size());
+    placed_.assign(hits_.size(), 0);
+    slot_.resize(hits_.size());
+    calo_.clear();
+    cellSubDetector_.clear();
+    CaloHitBuffer::Cell location{};
+    bool found = false;
+    std::uint32_t cell = 0;
+    std::uint64_t current = ~std::uint64_t(0);
+    for (const std::uint64_t key : keys_) {
+      const std::uint32_t rawId = key >> 32;
+      if (rawId != current) {
+        current = rawId;
+        found = traits_.locate(geometry, DetId(rawId), location);
+        if (found) {
+          cell = calo_.addCell(location);
+          cellSubDetector_.push_back(traits_.subDetector(DetId(rawId)));
+        }
+      }
+      if (!found)
+        continue;
+      const std::uint32_t i = key & 0xffffffff;
+      const Hit& hit = *hits_[i];
+      slot_[i] = calo_.size();
+      calo_.push_back(cell, rawId, static_cast<float>(hit.energy()), static_cast<float>(hit.time()));
+      placed_[i] = 1;
+    }
+    calo_.applyCorrections();
+  }
+
+  Traits traits_;
+  std::vector<const Hit*> hits_;
+  std::vector<std::uint64_t> keys_;
+  std::vector<HitRow> rows_;
+  std::vector<std::uint8_t> placed_;
+
+  // Staged traits only: the batch, the position of each hit in it and the subdetector of each cell
+  CaloHitBuffer calo_;
+  std::vector<std::uint32_t> slot_;
+  std::vector<HitSubDetector> cellSubDetector_;
+};
+
+// Tracker and muon sim hits, placed on their detector unit. ReportMissing logs the DetIds missing from the geometry.
+template <bool ReportMissing>
+struct TrackingHitTraits {
+  using Hit = PSimHit;
+  using Location = const GeomDet*;
+  static constexpr bool staged = false;
+
+  DetId detId(const Hit& hit, const RunGeometryCache&) const { return DetId(hit.detUnitId()); }
+
+  bool locate(const RunGeometryCache& geometry, DetId detId, Location& det) const {
+    det = geometry.trackingDet(detId);
+    if (ReportMissing && det == nullptr)
+      edm::LogError("TrackerHitAnalyzer::analyze") << "Invalid DetID: " << detId.rawId();
+    return det != nullptr;
+  }
+
+  void place(const Location& det, const Hit& hit, HitRow& row) const {
+    const GlobalPoint position = det->toGlobal(hit.localPosition());
+    row.energy = hit.energyLoss();
+    row.x = position.x();
+    row.y = position.y();
+    row.z = position.z();
+    row.r = std::sqrt(row.x * row.x + row.y * row.y);
+  }
+
+  unsigned int trackId(const Hit& hit) const { return hit.trackId(); }
+  HitSubDetector subDetector(DetId detId) const { return hitSubDetector(detId); }
+};
+
+using TrackerHitTraits = TrackingHitTraits<true>;
+using MuonHitTraits = TrackingHitTraits<false>;  // the cache holds the CSC, DT, RPC and GEM units, other hits are skipped
+
+// ECAL hits, placed on the cached cell or, for cells missing from the cache, on the calorimeter geometry
+struct EcalHitTraits {
+  using Hit = PCaloHit;
+  using Location = CaloHitBuffer::Cell;
+  static constexpr bool staged = true;
+
+  DetId detId(const Hit& hit, const RunGeometryCache&) const { return DetId(hit.id()); }
+
+  // ECAL energies are not corrected, the response correction of every cell is 1
+  bool locate(const RunGeometryCache& geometry, DetId detId, Location& location) const {
+    const RunGeometryCache::CaloCell* cell = geometry.caloCell(detId);
+    if (cell != nullptr) {
+      location = {cell->position.x(), cell->position.y(), cell->position.z(), cell->r, 1.f};
+    } else {
+      const GlobalPoint position = geometry.calo->getPosition(detId);
+      location = {position.x(),
+                  position.y(),
+                  position.z(),
+                  std::sqrt(position.x() * position.x() + position.y() * position.y()),
+                  1.f};
+    }
+    return true;
+  }
+
+  unsigned int trackId(const Hit& hit) const { return static_cast<unsigned int>(hit.geantTrackId()); }
+  HitSubDetector subDetector(DetId detId) const { return hitSubDetector(detId); }
+};
+
+// HCAL hits, placed on their cell and corrected for its response. Cells missing from the cache are skipped.
+struct HcalHitTraits {
+  using Hit = PCaloHit;
+  using Location = CaloHitBuffer::Cell;
+  static constexpr bool staged = true;
+
+  bool testNumbering = true;  // sim hits use the HCAL test numbering, the geometry uses reconstruction DetIds
+
+  DetId detId(const Hit& hit, const RunGeometryCache& geometry) const {
+    return testNumbering ? HcalHitRelabeller::relabel(hit.id(), geometry.hcons) : DetId(hit.id());
+  }
+
+  bool locate(const RunGeometryCache& geometry, DetId detId, Location& location) const {
+    const RunGeometryCache::CaloCell* cell = geometry.caloCell(detId);
+    if (cell == nullptr)
+      return false;
+    location = {cell->position.x(), cell->position.y(), cell->position.z(), cell->r, cell->respCorr};
+    return true;
+  }
+
+  unsigned int trackId(const Hit& hit) const { return static_cast<unsigned int>(hit.geantTrackId()); }
+  HitSubDetector subDetector(DetId) const { return HitSubDetector::HCAL; }
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include "RunGeometryCache.h"
+
+#include <cmath>
+
+#include "DataFormats/EcalDetId/interface/EcalSubdetector.h"
+#include "DataFormats/HcalDetId/interface/HcalSubdetector.h"
+#include "DataFormats/MuonDetId/interface/DTWireId.h"
+#include "DataFormats/MuonDetId/interface/MuonSubdetId.h"
+
+void RunGeometryCache::build() {
+  detUnits_.clear();
+  caloCells_.clear();
+
+  addDetUnits(tracker);
+  addDetUnits(csc);
+  addDetUnits(dt);
+  addDetUnits(rpc);
+  addDetUnits(gem);
+
+  addCaloCells(DetId::Ecal, EcalBarrel);
+  addCaloCells(DetId::Ecal, EcalEndcap);
+  addCaloCells(DetId::Ecal, EcalPreshower);
+  addCaloCells(DetId::Hcal, HcalBarrel);
+  addCaloCells(DetId::Hcal, HcalEndcap);
+  addCaloCells(DetId::Hcal, HcalOuter);
+  addCaloCells(DetId::Hcal, HcalForward);
+}
+
+const GeomDet* RunGeometryCache::trackingDet(DetId detId) const {
+  // DT sim hits are recorded per wire, while the DT geometry stops at the layer
+  if (detId.det() == DetId::Muon && detId.subdetId() == MuonSubdetId::DT)
+    detId = DTWireId(detId.rawId()).layerId();
+
+  auto det = detUnits_.find(detId.rawId());
+  return det == detUnits_.end() ? nullptr : det->second;
+}
+
+const RunGeometryCache::CaloCell* RunGeometryCache::caloCell(DetId detId) const {
+  auto cell = caloCells_.find(detId.rawId());
+  return cell == caloCells_.end() ? nullptr : &cell->second;
+}
+
+void RunGeometryCache::addDetUnits(const TrackingGeometry* geometry) {
+  if (geometry == nullptr)
+    return;
+
+  const auto& dets = geometry->detUnits();
+  detUnits_.reserve(detUnits_.size() + dets.size());
+  for (const auto* det : dets)
+    detUnits_.emplace(det->geographicalId().rawId(), det);
+}
+
+void RunGeometryCache::addCaloCells(DetId::Detector det, int subdet) {
+  if (calo == nullptr)
+    return;
+
+  const auto& ids = calo->getValidDetIds(det, subdet);
+  caloCells_.reserve(caloCells_.size() + ids.size());
+  for (const auto& id : ids) {
+    auto cell = calo->getGeometry(id);
+    if (!cell)
+      continue;
+    const GlobalPoint position = cell->getPosition();
+    const float r = std::sqrt(position.x() * position.x() + position.y() * position.y());
+
+    float respCorr = 1.f;
+    if (det == DetId::Hcal && respCorrs) {
+      const HcalRespCorr* corr = respCorrs->getValues(id, false);
+      if (corr != nullptr)
+        respCorr = corr->getValue();
+    }
+
+    caloCells_.emplace(id.rawId(), CaloCell{cell.get(), position, r, respCorr});
+  }
+}
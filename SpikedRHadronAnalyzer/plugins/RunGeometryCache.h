@@ -0,0 +1,66 @@
+#ifndef RHadronProduction_SpikedRHadronAnalyzer_RunGeometryCache_h
+#define RHadronProduction_SpikedRHadronAnalyzer_RunGeometryCache_h
+
+/**\class RunGeometryCache RunGeometryCache.h
+
+ Description: [Geometry of one run, resolved per DetId so the hit loops never walk the geometry]
+
+ Implementation:
+     [Built once in globalBeginRun and only read afterwards, so all streams can share it without
+      locking. Tracker and muon sim hits are resolved to their detector unit. Calorimeter cells
+      keep their precomputed global position and transverse radius, and HCAL cells also their
+      response correction.]
+*/
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "DataFormats/DetId/interface/DetId.h"
+#include "DataFormats/GeometryVector/interface/GlobalPoint.h"
+#include "Geometry/CaloGeometry/interface/CaloCellGeometry.h"
+#include "Geometry/CaloGeometry/interface/CaloGeometry.h"
+#include "Geometry/CommonDetUnit/interface/GeomDet.h"
+#include "Geometry/CommonDetUnit/interface/TrackingGeometry.h"
+#include "Geometry/HcalCommonData/interface/HcalDDDRecConstants.h"
+#include "CondFormats/HcalObjects/interface/HcalRespCorrs.h"
+
+class RunGeometryCache {
+public:
+  struct CaloCell {
+    const CaloCellGeometry* geometry;
+    GlobalPoint position;
+    float r;
+    float respCorr;
+  };
+
+  // Geometry products of the run, owned by the EventSetup
+  const TrackingGeometry* tracker = nullptr;
+  const CaloGeometry* calo = nullptr;
+  const TrackingGeometry* csc = nullptr;
+  const TrackingGeometry* dt = nullptr;
+  const TrackingGeometry* rpc = nullptr;
+  const TrackingGeometry* gem = nullptr;
+
+  // HCAL numbering and response corrections, the corrections are a copy with the HCAL topology set
+  const HcalDDDRecConstants* hcons = nullptr;
+  std::unique_ptr<HcalRespCorrs> respCorrs;
+
+  // Resolves every detector unit and calorimeter cell, called once the geometry pointers are set
+  void build();
+
+  // Detector unit holding a tracker or muon sim hit, nullptr if the DetId is not in the geometry
+  const GeomDet* trackingDet(DetId detId) const;
+
+  // Cached calorimeter cell, nullptr if the DetId is not in the geometry
+  const CaloCell* caloCell(DetId detId) const;
+
+private:
+  void addDetUnits(const TrackingGeometry* geometry);
+  void addCaloCells(DetId::Detector det, int subdet);
+
+  std::unordered_map<std::uint32_t, const GeomDet*> detUnits_;
+  std::unordered_map<std::uint32_t, CaloCell> caloCells_;
+};
+
+#endif
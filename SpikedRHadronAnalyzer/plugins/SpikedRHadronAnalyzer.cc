@@ -25,10 +25,25 @@
 #include <vector>
 #include <sstream>
 #include <string>
+#include <algorithm>
+#include <array>
+#include <mutex>
+
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/AsyncHitWriter.h"
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/ChainedRange.h"
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitAggregator.h"
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitColumns.h"
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitRoiFilter.h"
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitWriter.h"
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/SimTrackIndex.h"
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/SimTruthGraph.h"
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/StageProfiler.h"
+#include "HitKernel.h"
+#include "RunGeometryCache.h"
 
 //Triggers and Handles
 #include "FWCore/Framework/interface/Frameworkfwd.h"
-#include "FWCore/Framework/interface/one/EDAnalyzer.h"
+#include "FWCore/Framework/interface/global/EDAnalyzer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/MakerMacros.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
@@ -135,267 +150,266 @@ using namespace std;
 using namespace __gnu_cxx;
 using namespace trigger;
 
-int evtcount = 0;
-
 class TupleMaker;
 class MCWeight;
 
-class SpikedRHadronAnalyzer : public edm::one::EDAnalyzer<edm::one::SharedResources> {
+namespace {
+  // Hit collections read by the analyzer, named after the configuration parameter holding their tag
+  constexpr std::array<const char*, 12> kTrackerHitCollections = {{
+    "TrackerHitsTIBLowTof", "TrackerHitsTIBHighTof", "TrackerHitsTOBLowTof", "TrackerHitsTOBHighTof",
+    "TrackerHitsTIDLowTof", "TrackerHitsTIDHighTof", "TrackerHitsTECLowTof", "TrackerHitsTECHighTof",
+    "TrackerHitsPixelBarrelLowTof", "TrackerHitsPixelBarrelHighTof", "TrackerHitsPixelEndcapLowTof", "TrackerHitsPixelEndcapHighTof"
+  }};
+  constexpr std::array<const char*, 3> kEcalHitCollections = {{"EcalHitsEB", "EcalHitsEE", "EcalHitsES"}};
+  constexpr std::array<const char*, 4> kMuonHitCollections = {{"MuonDTHits", "MuonCSCHits", "MuonRPCHits", "MuonGEMHits"}};
+
+  // Per-stream working storage, kept between events
+  struct StreamBuffer {
+    SimTrackIndex trackIndex;
+    SimTruthGraph truth;
+    HitKernel<TrackerHitTraits> trackerHits;
+    HitKernel<EcalHitTraits> ecalHits;
+    HitKernel<HcalHitTraits> hcalHits;
+    HitKernel<MuonHitTraits> muonHits;
+    std::unique_ptr<HitAggregator> aggregator;  // only in outputMode "summary"
+    std::unique_ptr<HitRoiFilter> roiFilter;    // only with roiMode
+    std::unique_ptr<StageProfiler> profiler;    // only with a profileFile
+  };
+
+  // Directions of the two highest-pt final-state R-hadrons (status 1, SimTruthGraph::isRHadron). No pt or eta
+  // cut is applied, unlike SpikedRHadronEventSelector, so the regions follow every R-hadron that leaves hits.
+  std::size_t rHadronDirections(const std::vector<reco::GenParticle>& genParticles, std::array<HitRoiFilter::Direction, 2>& directions) {
+    std::array<const reco::GenParticle*, 2> leading = {{nullptr, nullptr}};
+    for (const auto& particle : genParticles) {
+      if (particle.status() != 1 || !SimTruthGraph::isRHadron(particle.pdgId()))
+        continue;
+      if (leading[0] == nullptr || particle.pt() > leading[0]->pt()) {
+        leading[1] = leading[0];
+        leading[0] = &particle;
+      } else if (leading[1] == nullptr || particle.pt() > leading[1]->pt()) {
+        leading[1] = &particle;
+      }
+    }
+    std::size_t n = 0;
+    for (const reco::GenParticle* particle : leading) {
+      if (particle != nullptr)
+        directions[n++] = {static_cast<float>(particle->eta()), static_cast<float>(particle->phi())};
+    }
+    return n;
+  }
+}
+
+class SpikedRHadronAnalyzer : public edm::global::EDAnalyzer<edm::StreamCache<StreamBuffer>, edm::RunCache<RunGeometryCache>> {
 public:
   explicit SpikedRHadronAnalyzer (const edm::ParameterSet&);
-  ~SpikedRHadronAnalyzer();
 
 
 private:
-  virtual void analyze(const edm::Event&, const edm::EventSetup&) override;
+  std::unique_ptr<StreamBuffer> beginStream(edm::StreamID) const override;
+  std::shared_ptr<RunGeometryCache> globalBeginRun(const edm::Run&, const edm::EventSetup&) const override;
+  void globalEndRun(const edm::Run&, const edm::EventSetup&) const override {}
+  void analyze(edm::StreamID, const edm::Event&, const edm::EventSetup&) const override;
+  void endStream(edm::StreamID) const override;
+  void beginJob() override;
+  void endJob() override;
 
   edm::EDGetTokenT<vector<reco::GenParticle>> genParticlesToken_;
   std::string outputFileName;
+  std::string outputFormat;
+  std::string outputMode;
+  HitAggregator::Config summaryBinning_;
+  bool roiMode_;
+  HitRoiFilter::Config roiConfig_;
 
   // Tracks and Vertices
   edm::EDGetTokenT<edm::SimTrackContainer> edmSimTrackContainerToken_;
   edm::EDGetTokenT<edm::SimVertexContainer> edmSimVertexContainerToken_;
   edm::EDGetTokenT<edm::PSimHitContainer> edmSimHitContainerToken_;
 
-  // Tracker hits
-  edm::EDGetTokenT<edm::PSimHitContainer> edmPSimHitContainer_siTIBLow_Token_;
-  edm::EDGetTokenT<edm::PSimHitContainer> edmPSimHitContainer_siTIBHigh_Token_;
-  edm::EDGetTokenT<edm::PSimHitContainer> edmPSimHitContainer_siTOBLow_Token_;
-  edm::EDGetTokenT<edm::PSimHitContainer> edmPSimHitContainer_siTOBHigh_Token_;
-  edm::EDGetTokenT<edm::PSimHitContainer> edmPSimHitContainer_siTIDLow_Token_;
-  edm::EDGetTokenT<edm::PSimHitContainer> edmPSimHitContainer_siTIDHigh_Token_;
-  edm::EDGetTokenT<edm::PSimHitContainer> edmPSimHitContainer_siTECLow_Token_;
-  edm::EDGetTokenT <edm::PSimHitContainer> edmPSimHitContainer_siTECHigh_Token_;
-  edm::EDGetTokenT <edm::PSimHitContainer> edmPSimHitContainer_pxlBrlLow_Token_;
-  edm::EDGetTokenT <edm::PSimHitContainer> edmPSimHitContainer_pxlBrlHigh_Token_;
-  edm::EDGetTokenT <edm::PSimHitContainer> edmPSimHitContainer_pxlFwdLow_Token_;
-  edm::EDGetTokenT <edm::PSimHitContainer> edmPSimHitContainer_pxlFwdHigh_Token_;
-
-  // ECAL hits
-  edm::EDGetTokenT <edm::PCaloHitContainer> edmCaloHitContainer_EcalHitsEB_Token_;
-  edm::EDGetTokenT <edm::PCaloHitContainer> edmCaloHitContainer_EcalHitsEE_Token_;
-  edm::EDGetTokenT <edm::PCaloHitContainer> edmCaloHitContainer_EcalHitsES_Token_;
+  // Geometries, fetched once per run
+  edm::ESGetToken<TrackerGeometry, TrackerDigiGeometryRecord> tok_trackerGeometry_;
+  edm::ESGetToken<CaloGeometry, CaloGeometryRecord> tok_caloGeometry_;
+  edm::ESGetToken<CSCGeometry, MuonGeometryRecord> tok_cscGeometry_;
+  edm::ESGetToken<DTGeometry, MuonGeometryRecord> tok_dtGeometry_;
+  edm::ESGetToken<RPCGeometry, MuonGeometryRecord> tok_rpcGeometry_;
+  edm::ESGetToken<GEMGeometry, MuonGeometryRecord> tok_gemGeometry_;
+
+  // Tracker, ECAL and HCAL hits
+  std::array<edm::EDGetTokenT<edm::PSimHitContainer>, kTrackerHitCollections.size()> trackerHitTokens_;
+  std::array<edm::EDGetTokenT<edm::PCaloHitContainer>, kEcalHitCollections.size()> ecalHitTokens_;
   edm::EDGetTokenT <edm::PCaloHitContainer> edmCaloHitContainer_HcalHits_Token_;
 
-  // HCAL hits
-  const HcalDDDRecConstants *hcons_         ;
-  const CaloGeometry        *geometry_      ;
-  const CaloTopology        *topology_      ;
-  const HcalTopology        *hcalTopology_  ;
-  const HcalRespCorrs       *respCorrs_     ;
-  HcalRespCorrs             *respCorrs      ;
+  // HCAL hits, the numbering constants and response corrections are kept in the run cache
+  bool hcalTestNumbering_;
 
   const edm::ESGetToken< HcalDDDRecConstants, HcalRecNumberingRecord > tok_HRNDC_        ;
-  const edm::ESGetToken< CaloTopology,        CaloTopologyRecord     > tok_caloTopology_ ;
   const edm::ESGetToken< HcalTopology,        HcalRecNumberingRecord > tok_hcalTopology_ ;
   const edm::ESGetToken< HcalRespCorrs,       HcalRespCorrsRcd       > tok_resp_         ;
 
   // Muon hits
-  edm::EDGetTokenT <edm::PSimHitContainer> edmPSimHitContainer_muonCSC_Token_;
-  edm::EDGetTokenT <edm::PSimHitContainer> edmPSimHitContainer_muonDT_Token_;
-  edm::EDGetTokenT <edm::PSimHitContainer> edmPSimHitContainer_muonRPC_Token_;
-  edm::EDGetTokenT <edm::PSimHitContainer> edmPSimHitContainer_muonGEM_Token_;
+  std::array<edm::EDGetTokenT<edm::PSimHitContainer>, kMuonHitCollections.size()> muonHitTokens_;
+
+  // Events are written by the output thread, which restores the event-number order at endJob
+  std::unique_ptr<AsyncHitWriter> output_;
 
-  std::ofstream csv;
+  // Stage timings, collected per stream and added at endStream, written at endJob when profileFile is set
+  std::string profileFile_;
+  StageProfiler::Clock::time_point jobStart_;
+  mutable std::mutex profileMutex_;
+  mutable StageProfiler jobProfile_;
+  mutable unsigned int profiledStreams_ = 0;
 };
 
 //constructor
-SpikedRHadronAnalyzer::SpikedRHadronAnalyzer(const edm::ParameterSet& iConfig) {
+SpikedRHadronAnalyzer::SpikedRHadronAnalyzer(const edm::ParameterSet& iConfig)
+    : tok_HRNDC_(esConsumes<HcalDDDRecConstants, HcalRecNumberingRecord, edm::Transition::BeginRun>()),
+      tok_hcalTopology_(esConsumes<HcalTopology, HcalRecNumberingRecord, edm::Transition::BeginRun>()),
+      tok_resp_(esConsumes<HcalRespCorrs, HcalRespCorrsRcd, edm::Transition::BeginRun>()) {
 
   outputFileName = iConfig.getParameter<std::string>("outputFileName");
+  outputFormat = iConfig.getParameter<std::string>("outputFormat");
+  outputMode = iConfig.getParameter<std::string>("outputMode");
+  summaryBinning_.etaBins = iConfig.getParameter<unsigned int>("summaryEtaBins");
+  summaryBinning_.etaMin = iConfig.getParameter<double>("summaryEtaMin");
+  summaryBinning_.etaMax = iConfig.getParameter<double>("summaryEtaMax");
+  summaryBinning_.phiBins = iConfig.getParameter<unsigned int>("summaryPhiBins");
+  summaryBinning_.energyBins = iConfig.getParameter<unsigned int>("summaryEnergyBins");
+  summaryBinning_.energyMin = iConfig.getParameter<double>("summaryEnergyMin");
+  summaryBinning_.energyMax = iConfig.getParameter<double>("summaryEnergyMax");
+  profileFile_ = iConfig.getParameter<std::string>("profileFile");
+
+  // Region of interest around the gen-level R-hadrons, the gen particles are only read when it is on
+  roiMode_ = iConfig.getParameter<bool>("roiMode");
+  roiConfig_.cone = {{static_cast<float>(iConfig.getParameter<double>("roiTrackerCone")),
+                      static_cast<float>(iConfig.getParameter<double>("roiEcalCone")),
+                      static_cast<float>(iConfig.getParameter<double>("roiHcalCone")),
+                      static_cast<float>(iConfig.getParameter<double>("roiMuonCone"))}};
+  roiConfig_.energyThreshold = iConfig.getParameter<double>("roiEnergyThreshold");
+  if (roiMode_)
+    genParticlesToken_ = consumes<vector<reco::GenParticle>>(iConfig.getParameter<edm::InputTag>("gen_info"));
   edmSimTrackContainerToken_ = consumes<edm::SimTrackContainer>(iConfig.getParameter<edm::InputTag>("G4TrkSrc"));
   edmSimVertexContainerToken_ = consumes<edm::SimVertexContainer>(iConfig.getParameter<edm::InputTag>("G4VtxSrc"));
 
-  // Tracker hits   
-  edmPSimHitContainer_siTIBLow_Token_ = consumes<edm::PSimHitContainer>(iConfig.getParameter<edm::InputTag>("TrackerHitsTIBLowTof"));
-  edmPSimHitContainer_siTIBHigh_Token_ = consumes<edm::PSimHitContainer>(iConfig.getParameter<edm::InputTag>("TrackerHitsTIBHighTof"));
-  edmPSimHitContainer_siTOBLow_Token_ = consumes<edm::PSimHitContainer>(iConfig.getParameter<edm::InputTag>("TrackerHitsTOBLowTof"));
-  edmPSimHitContainer_siTOBHigh_Token_ = consumes<edm::PSimHitContainer>(iConfig.getParameter<edm::InputTag>("TrackerHitsTOBHighTof"));
-  edmPSimHitContainer_siTIDLow_Token_ = consumes<edm::PSimHitContainer>(iConfig.getParameter<edm::InputTag>("TrackerHitsTIDLowTof"));
-  edmPSimHitContainer_siTIDHigh_Token_ = consumes<edm::PSimHitContainer>(iConfig.getParameter<edm::InputTag>("TrackerHitsTIDHighTof"));
-  edmPSimHitContainer_siTECLow_Token_ = consumes<edm::PSimHitContainer>(iConfig.getParameter<edm::InputTag>("TrackerHitsTECLowTof"));
-  edmPSimHitContainer_siTECHigh_Token_ = consumes<edm::PSimHitContainer>(iConfig.getParameter<edm::InputTag>("TrackerHitsTECHighTof"));
-  edmPSimHitContainer_pxlBrlLow_Token_ = consumes<edm::PSimHitContainer>(iConfig.getParameter<edm::InputTag>("TrackerHitsPixelBarrelLowTof"));
-  edmPSimHitContainer_pxlBrlHigh_Token_ = consumes<edm::PSimHitContainer>(iConfig.getParameter<edm::InputTag>("TrackerHitsPixelBarrelHighTof"));
-  edmPSimHitContainer_pxlFwdLow_Token_ = consumes<edm::PSimHitContainer>(iConfig.getParameter<edm::InputTag>("TrackerHitsPixelEndcapLowTof"));
-  edmPSimHitContainer_pxlFwdHigh_Token_ = consumes<edm::PSimHitContainer>(iConfig.getParameter<edm::InputTag>("TrackerHitsPixelEndcapHighTof"));
+  // Geometries
+  tok_trackerGeometry_ = esConsumes<TrackerGeometry, TrackerDigiGeometryRecord, edm::Transition::BeginRun>();
+  tok_caloGeometry_ = esConsumes<CaloGeometry, CaloGeometryRecord, edm::Transition::BeginRun>();
+  tok_cscGeometry_ = esConsumes<CSCGeometry, MuonGeometryRecord, edm::Transition::BeginRun>();
+  tok_dtGeometry_ = esConsumes<DTGeometry, MuonGeometryRecord, edm::Transition::BeginRun>();
+  tok_rpcGeometry_ = esConsumes<RPCGeometry, MuonGeometryRecord, edm::Transition::BeginRun>();
+  tok_gemGeometry_ = esConsumes<GEMGeometry, MuonGeometryRecord, edm::Transition::BeginRun>();
+
+  // Tracker hits
+  for (std::size_t i = 0; i < kTrackerHitCollections.size(); ++i)
+    trackerHitTokens_[i] = consumes<edm::PSimHitContainer>(iConfig.getParameter<edm::InputTag>(kTrackerHitCollections[i]));
 
   // Calorimiter
-  edmCaloHitContainer_EcalHitsEB_Token_ = consumes<edm::PCaloHitContainer>(iConfig.getParameter<edm::InputTag>("EcalHitsEB"));
-  edmCaloHitContainer_EcalHitsEE_Token_ = consumes<edm::PCaloHitContainer>(iConfig.getParameter<edm::InputTag>("EcalHitsEE"));
-  edmCaloHitContainer_EcalHitsES_Token_ = consumes<edm::PCaloHitContainer>(iConfig.getParameter<edm::InputTag>("EcalHitsES"));
+  for (std::size_t i = 0; i < kEcalHitCollections.size(); ++i)
+    ecalHitTokens_[i] = consumes<edm::PCaloHitContainer>(iConfig.getParameter<edm::InputTag>(kEcalHitCollections[i]));
   edmCaloHitContainer_HcalHits_Token_ = consumes<edm::PCaloHitContainer>(iConfig.getParameter<edm::InputTag>("HcalHits"));
+  hcalTestNumbering_ = iConfig.getParameter<bool>("HcalTestNumbering");
 
   // Muon Chamber
-  edmPSimHitContainer_muonCSC_Token_ = consumes<edm::PSimHitContainer>(iConfig.getParameter<edm::InputTag>("MuonCSCHits"));
-  edmPSimHitContainer_muonDT_Token_ = consumes<edm::PSimHitContainer>(iConfig.getParameter<edm::InputTag>("MuonDTHits"));
-  edmPSimHitContainer_muonRPC_Token_ = consumes<edm::PSimHitContainer>(iConfig.getParameter<edm::InputTag>("MuonRPCHits"));
-  edmPSimHitContainer_muonGEM_Token_ = consumes<edm::PSimHitContainer>(iConfig.getParameter<edm::InputTag>("MuonGEMHits"));
+  for (std::size_t i = 0; i < kMuonHitCollections.size(); ++i)
+    muonHitTokens_[i] = consumes<edm::PSimHitContainer>(iConfig.getParameter<edm::InputTag>(kMuonHitCollections[i]));
 
-  // Create csv for energy spike R-hadron analysis
-  csv.open (outputFileName);
-  csv << "Event,Energy Deposit,x [cm],y [cm],z [cm],r [cm],PDG,Track Energy,px,py,pz\n";
+  // Create the output for energy spike R-hadron analysis
+  output_ = std::make_unique<AsyncHitWriter>(HitWriter::create(outputFormat, outputFileName, outputMode),
+                                             iConfig.getParameter<unsigned int>("outputQueueSize"));
+}
 
-  evtcount = 0;
+std::unique_ptr<StreamBuffer> SpikedRHadronAnalyzer::beginStream(edm::StreamID) const {
+  auto buffer = std::make_unique<StreamBuffer>();
+  buffer->hcalHits = HitKernel<HcalHitTraits>(HcalHitTraits{hcalTestNumbering_});
+  if (outputMode == "summary")
+    buffer->aggregator = std::make_unique<HitAggregator>(summaryBinning_);
+  if (roiMode_)
+    buffer->roiFilter = std::make_unique<HitRoiFilter>(roiConfig_);
+  if (!profileFile_.empty())
+    buffer->profiler = std::make_unique<StageProfiler>();
+  return buffer;
 }
 
+void SpikedRHadronAnalyzer::endStream(edm::StreamID streamID) const {
+  const StageProfiler* profiler = streamCache(streamID)->profiler.get();
+  if (profiler == nullptr)
+    return;
+  std::lock_guard<std::mutex> lock(profileMutex_);
+  jobProfile_.add(*profiler);
+  ++profiledStreams_;
+}
 
-//destructor
-SpikedRHadronAnalyzer::~SpikedRHadronAnalyzer() {
-  csv.close();
+std::shared_ptr<RunGeometryCache> SpikedRHadronAnalyzer::globalBeginRun(const edm::Run&, const edm::EventSetup& iSetup) const {
+  // The detector does not change within a run, so every DetId is resolved once here
+  auto geometry = std::make_shared<RunGeometryCache>();
+  geometry->tracker = &iSetup.getData(tok_trackerGeometry_);
+  geometry->calo = &iSetup.getData(tok_caloGeometry_);
+  geometry->csc = &iSetup.getData(tok_cscGeometry_);
+  geometry->dt = &iSetup.getData(tok_dtGeometry_);
+  geometry->rpc = &iSetup.getData(tok_rpcGeometry_);
+  geometry->gem = &iSetup.getData(tok_gemGeometry_);
+
+  // The response corrections need the HCAL topology to look cells up
+  geometry->hcons = &iSetup.getData(tok_HRNDC_);
+  geometry->respCorrs = std::make_unique<HcalRespCorrs>(iSetup.getData(tok_resp_));
+  geometry->respCorrs->setTopo(&iSetup.getData(tok_hcalTopology_));
+
+  geometry->build();
+  return geometry;
 }
 
-void SpikedRHadronAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup& iSetup) {
-
-  edm::SimTrackContainer::const_iterator simTrack;
-  edm::SimVertexContainer::const_iterator simVertex;
-  evtcount++;
-
-  // Select only the desired events
-  if ((evtcount > 10) && (evtcount != 539)) return;
-
-  // Tracker Containers
-   edm::Handle<edm::PSimHitContainer> SiTIBLowContainer;
-   iEvent.getByToken(edmPSimHitContainer_siTIBLow_Token_, SiTIBLowContainer);
-   if (!SiTIBLowContainer.isValid()) {
-     edm::LogError("TrackerHitProducer::analyze") << "Unable to find TrackerHitsTIBLowTof in event!";
-     return;
-   }
-
-   edm::Handle<edm::PSimHitContainer> SiTIBHighContainer;
-   iEvent.getByToken(edmPSimHitContainer_siTIBHigh_Token_, SiTIBHighContainer);
-   if (!SiTIBHighContainer.isValid()) {
-     edm::LogError("TrackerHitProducer::analyze") << "Unable to find TrackerHitsTIBHighTof in event!";
-     return;
-   }
-
-   edm::Handle<edm::PSimHitContainer> SiTOBLowContainer;
-   iEvent.getByToken(edmPSimHitContainer_siTOBLow_Token_, SiTOBLowContainer);
-   if (!SiTOBLowContainer.isValid()) {
-     edm::LogError("TrackerHitProducer::analyze") << "Unable to find TrackerHitsTOBLowTof in event!";
-     return;
-   }
-
-   edm::Handle<edm::PSimHitContainer> SiTOBHighContainer;
-   iEvent.getByToken(edmPSimHitContainer_siTOBHigh_Token_, SiTOBHighContainer);
-   if (!SiTOBHighContainer.isValid()) {
-     edm::LogError("TrackerHitProducer::analyze") << "Unable to find TrackerHitsTOBHighTof in event!";
-     return;
-   }
-
-   edm::Handle<edm::PSimHitContainer> SiTIDLowContainer;
-   iEvent.getByToken(edmPSimHitContainer_siTIDLow_Token_, SiTIDLowContainer);
-   if (!SiTIDLowContainer.isValid()) {
-     edm::LogError("TrackerHitProducer::analyze") << "Unable to find TrackerHitsTIDLowTof in event!";
-     return;
-   }
-
-   edm::Handle<edm::PSimHitContainer> SiTIDHighContainer;
-   iEvent.getByToken(edmPSimHitContainer_siTIDHigh_Token_, SiTIDHighContainer);
-   if (!SiTIDHighContainer.isValid()) {
-     edm::LogError("TrackerHitProducer::analyze") << "Unable to find TrackerHitsTIDHighTof in event!";
-     return;
-   }
-
-   edm::Handle<edm::PSimHitContainer> SiTECLowContainer;
-   iEvent.getByToken(edmPSimHitContainer_siTECLow_Token_, SiTECLowContainer);
-   if (!SiTECLowContainer.isValid()) {
-     edm::LogError("TrackerHitProducer::analyze") << "Unable to find TrackerHitsTECLowTof in event!";
-     return;
-   }
-
-   edm::Handle<edm::PSimHitContainer> SiTECHighContainer;
-   iEvent.getByToken(edmPSimHitContainer_siTECHigh_Token_, SiTECHighContainer);
-   if (!SiTECHighContainer.isValid()) {
-     edm::LogError("TrackerHitProducer::analyze") << "Unable to find TrackerHitsTECHighTof in event!";
-     return;
-   }
-
-   edm::Handle<edm::PSimHitContainer> PxlBrlLowContainer;
-   iEvent.getByToken(edmPSimHitContainer_pxlBrlLow_Token_, PxlBrlLowContainer);
-   if (!PxlBrlLowContainer.isValid()) {
-     edm::LogError("TrackerHitAnalyzer::analyze") << "Unable to find TrackerHitsPixelBarrelLowTof in event!";
-     return;
-   }
-
-   edm::Handle<edm::PSimHitContainer> PxlBrlHighContainer;
-   iEvent.getByToken(edmPSimHitContainer_pxlBrlHigh_Token_, PxlBrlHighContainer);
-   if (!PxlBrlHighContainer.isValid()) {
-     edm::LogError("TrackerHitAnalyzer::analyze") << "Unable to find TrackerHitsPixelBarrelHighTof in event!";
-     return;
-   }
-
-   edm::Handle<edm::PSimHitContainer> PxlFwdLowContainer;
-   iEvent.getByToken(edmPSimHitContainer_pxlFwdLow_Token_, PxlFwdLowContainer);
-   if (!PxlFwdLowContainer.isValid()) {
-     edm::LogError("TrackerHitAnalyzer::analyze") << "Unable to find TrackerHitsPixelEndcapLowTof in event!";
-     return;
-   }
-
-   edm::Handle<edm::PSimHitContainer> PxlFwdHighContainer;
-   iEvent.getByToken(edmPSimHitContainer_pxlFwdHigh_Token_, PxlFwdHighContainer);
-   if (!PxlFwdHighContainer.isValid()) {
-     edm::LogError("TrackerHitAnalyzer::analyze") << "Unable to find TrackerHitsPixelEndcapHighTof in event!";
-     return;
-   }
-
-    // Calorimiter Containers
-    edm::Handle<edm::PCaloHitContainer> EcalEBContainer;
-    iEvent.getByToken(edmCaloHitContainer_EcalHitsEB_Token_, EcalEBContainer);
-    if (!EcalEBContainer.isValid()) {
-        edm::LogError("CaloHitProducer::analyze") << "Unable to find EcalHitsEB in event!";
-        return;
-   }
-
-    edm::Handle<edm::PCaloHitContainer> EcalEEContainer;
-    iEvent.getByToken(edmCaloHitContainer_EcalHitsEE_Token_, EcalEEContainer);
-    if (!EcalEEContainer.isValid()) {
-        edm::LogError("CaloHitProducer::analyze") << "Unable to find EcalHitsEE in event!";
-        return;
-   }
-
-    edm::Handle<edm::PCaloHitContainer> EcalESContainer;
-    iEvent.getByToken(edmCaloHitContainer_EcalHitsES_Token_, EcalESContainer);
-    if (!EcalESContainer.isValid()) {
-        edm::LogError("CaloHitProducer::analyze") << "Unable to find EcalHitsES in event!";
-        return;
-   }
-  
-    edm::Handle<edm::PCaloHitContainer> HcalContainer;
-    iEvent.getByToken(edmCaloHitContainer_HcalHits_Token_, HcalContainer);
-    if (!HcalContainer.isValid()) {
-        edm::LogError("CaloHitProducer::analyze") << "Unable to find HcalHits in event!";
-        return;
-   }
-
-   // Muon Chamber Containers
-   edm::Handle<edm::PSimHitContainer> MuonDTContainer;
-   iEvent.getByToken(edmPSimHitContainer_muonDT_Token_, MuonDTContainer);
-   if (!MuonDTContainer.isValid()) {
-     edm::LogError("TrackerHitAnalyzer::analyze") << "Unable to find MuonDT simhits in event!";
-     return;
-   }
-
-   edm::Handle<edm::PSimHitContainer> MuonCSCContainer;
-   iEvent.getByToken(edmPSimHitContainer_muonCSC_Token_, MuonCSCContainer);
-   if (!MuonCSCContainer.isValid()) {
-     edm::LogError("TrackerHitAnalyzer::analyze") << "Unable to find MuonCSC simhits in event!";
-     return;
-   }
-
-    edm::Handle<edm::PSimHitContainer> MuonRPCContainer;
-    iEvent.getByToken(edmPSimHitContainer_muonRPC_Token_, MuonRPCContainer);
-    if (!MuonRPCContainer.isValid()) {
-        edm::LogError("TrackerHitAnalyzer::analyze") << "Unable to find MuonRPC simhits in event!";
-        return;
+void SpikedRHadronAnalyzer::analyze(edm::StreamID streamID, const edm::Event& iEvent, const edm::EventSetup& iSetup) const {
+
+  // Events are identified by their number rather than by the order in which a stream sees them.
+  // Event selection is done upstream by SpikedRHadronEventSelector.
+  const edm::EventNumber_t evtcount = iEvent.id().event();
+
+  // Every stage below is timed when profiling is on, the timers do nothing otherwise
+  StageProfiler* profiler = streamCache(streamID)->profiler.get();
+  ScopedStageTimer eventTimer(profiler, AnalyzerStage::Event);
+  ScopedStageTimer productsTimer(profiler, AnalyzerStage::Products);
+
+  // Tracker Containers, viewed in place as one range
+  ChainedRange<PSimHit, kTrackerHitCollections.size()> G4SimHitContainer;
+  for (std::size_t i = 0; i < trackerHitTokens_.size(); ++i) {
+    edm::Handle<edm::PSimHitContainer> collection;
+    iEvent.getByToken(trackerHitTokens_[i], collection);
+    if (!collection.isValid()) {
+      edm::LogError("TrackerHitProducer::analyze") << "Unable to find " << kTrackerHitCollections[i] << " in event!";
+      return;
     }
+    G4SimHitContainer.append(*collection);
+  }
+
+  // Calorimiter Containers
+  ChainedRange<PCaloHit, kEcalHitCollections.size()> G4CaloHitContainer;
+  for (std::size_t i = 0; i < ecalHitTokens_.size(); ++i) {
+    edm::Handle<edm::PCaloHitContainer> collection;
+    iEvent.getByToken(ecalHitTokens_[i], collection);
+    if (!collection.isValid()) {
+      edm::LogError("CaloHitProducer::analyze") << "Unable to find " << kEcalHitCollections[i] << " in event!";
+      return;
+    }
+    G4CaloHitContainer.append(*collection);
+  }
 
-    edm::Handle<edm::PSimHitContainer> MuonGEMContainer;
-    iEvent.getByToken(edmPSimHitContainer_muonGEM_Token_, MuonGEMContainer);
-    if (!MuonGEMContainer.isValid()) {
-        edm::LogError("TrackerHitAnalyzer::analyze") << "Unable to find MuonGEM simhits in event!";
-        return;
+  edm::Handle<edm::PCaloHitContainer> HcalContainer;
+  iEvent.getByToken(edmCaloHitContainer_HcalHits_Token_, HcalContainer);
+  if (!HcalContainer.isValid()) {
+    edm::LogError("CaloHitProducer::analyze") << "Unable to find HcalHits in event!";
+    return;
+  }
+
+  // Muon Chamber Containers
+  ChainedRange<PSimHit, kMuonHitCollections.size()> G4MuonContainer;
+  for (std::size_t i = 0; i < muonHitTokens_.size(); ++i) {
+    edm::Handle<edm::PSimHitContainer> collection;
+    iEvent.getByToken(muonHitTokens_[i], collection);
+    if (!collection.isValid()) {
+      edm::LogError("TrackerHitAnalyzer::analyze") << "Unable to find " << kMuonHitCollections[i] << " in event!";
+      return;
     }
+    G4MuonContainer.append(*collection);
+  }
 
   // Get G4SimTracks
   edm::Handle<edm::SimTrackContainer> G4TrkContainer;
@@ -413,185 +427,114 @@ void SpikedRHadronAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSe
     return;
   }
 
-  // Combine tracker simhit containers
-  edm::PSimHitContainer G4SimHitContainer;
-  G4SimHitContainer.insert(G4SimHitContainer.end(), SiTIBLowContainer->begin(), SiTIBLowContainer->end());
-  G4SimHitContainer.insert(G4SimHitContainer.end(), SiTIBHighContainer->begin(), SiTIBHighContainer->end());
-  G4SimHitContainer.insert(G4SimHitContainer.end(), SiTOBLowContainer->begin(), SiTOBLowContainer->end());
-  G4SimHitContainer.insert(G4SimHitContainer.end(), SiTOBHighContainer->begin(), SiTOBHighContainer->end());
-  G4SimHitContainer.insert(G4SimHitContainer.end(), SiTIDLowContainer->begin(), SiTIDLowContainer->end());
-  G4SimHitContainer.insert(G4SimHitContainer.end(), SiTIDHighContainer->begin(), SiTIDHighContainer->end());
-  G4SimHitContainer.insert(G4SimHitContainer.end(), SiTECLowContainer->begin(), SiTECLowContainer->end());
-  G4SimHitContainer.insert(G4SimHitContainer.end(), SiTECHighContainer->begin(), SiTECHighContainer->end());
-  G4SimHitContainer.insert(G4SimHitContainer.end(), PxlBrlLowContainer->begin(), PxlBrlLowContainer->end());
-  G4SimHitContainer.insert(G4SimHitContainer.end(), PxlBrlHighContainer->begin(), PxlBrlHighContainer->end());
-  G4SimHitContainer.insert(G4SimHitContainer.end(), PxlFwdLowContainer->begin(), PxlFwdLowContainer->end());
-  G4SimHitContainer.insert(G4SimHitContainer.end(), PxlFwdHighContainer->begin(), PxlFwdHighContainer->end());
-  
-  // Combine ECAL calohit containers
-  edm::PCaloHitContainer G4CaloHitContainer;
-  G4CaloHitContainer.insert(G4CaloHitContainer.end(), EcalEBContainer->begin(), EcalEBContainer->end());
-  G4CaloHitContainer.insert(G4CaloHitContainer.end(), EcalEEContainer->begin(), EcalEEContainer->end());
-  G4CaloHitContainer.insert(G4CaloHitContainer.end(), EcalESContainer->begin(), EcalESContainer->end());
-
-  // Combine muon chamber simhit containers
-  edm::PSimHitContainer G4MuonContainer;
-  G4MuonContainer.insert(G4MuonContainer.end(), MuonDTContainer->begin(), MuonDTContainer->end());
-  G4MuonContainer.insert(G4MuonContainer.end(), MuonCSCContainer->begin(), MuonCSCContainer->end());
-  G4MuonContainer.insert(G4MuonContainer.end(), MuonRPCContainer->begin(), MuonRPCContainer->end());
-  G4MuonContainer.insert(G4MuonContainer.end(), MuonGEMContainer->begin(), MuonGEMContainer->end());
-
-  // Grab geometries
-  edm::ESHandle<CaloGeometry> caloGeometry;
-  edm::ESHandle<TrackerGeometry> tkGeometry;
-  edm::ESHandle<CSCGeometry> cscGeometry;
-  edm::ESHandle<DTGeometry> dtGeometry;
-  edm::ESHandle<RPCGeometry> rpcGeometry;
-  edm::ESHandle<GEMGeometry> gemGeometry;
-  iSetup.get<TrackerDigiGeometryRecord>().get(tkGeometry);
-  iSetup.get<CaloGeometryRecord>().get(caloGeometry);
-  iSetup.get<MuonGeometryRecord>().get(cscGeometry);
-  iSetup.get<MuonGeometryRecord>().get(dtGeometry);
-  iSetup.get<MuonGeometryRecord>().get(rpcGeometry);
-  iSetup.get<MuonGeometryRecord>().get(gemGeometry);
-
-  // Begin loop over tracker sim hits
-  for (auto simHit = G4SimHitContainer.begin(); simHit != G4SimHitContainer.end(); ++simHit) {
-    // Get the energy deposited
-    double energyDeposit = simHit->energyLoss();
-
-    // Get the location (r and z) of the hit
-    DetId detId = DetId(simHit->detUnitId());
-    try {
-      const GeomDetUnit *det = (const GeomDetUnit *)tkGeometry->idToDetUnit(detId);
-      GlobalPoint globalPosition = det->toGlobal(simHit->localPosition());
-      double x = globalPosition.x();
-      double y = globalPosition.y();
-      double z = globalPosition.z();
-      double r = sqrt(globalPosition.x() * globalPosition.x() + globalPosition.y() * globalPosition.y());
-
-      // Find the corresponding SimTrack
-      auto trackId = simHit->trackId();
-      auto simTrack = std::find_if(G4TrkContainer->begin(), G4TrkContainer->end(), [trackId](const SimTrack& track) {
-        return static_cast<decltype(trackId)>(track.trackId()) == trackId;
-      });
-
-      if (simTrack != G4TrkContainer->end()) {
-        // Get the particle type that caused the hit
-        int particleType = simTrack->type();
-
-        // Get the momentum of the particle that caused the hit
-        auto momentum = simTrack->momentum();
-
-        // Log the information
-        csv << evtcount << "," << energyDeposit << "," << x << "," << y << "," << z << "," << r << "," << particleType << ',' << momentum.E() << ',' << momentum.Px() << ',' << momentum.Py() << ',' << momentum.Pz() << '\n';
-      }
-    } catch (const cms::Exception& e) {
-      edm::LogError("TrackerHitAnalyzer::analyze") << "Invalid DetID: " << e.what();
-      continue;
-    }
-    const GeomDetUnit *det = (const GeomDetUnit *)tkGeometry->idToDetUnit(detId);
-    GlobalPoint globalPosition = det->toGlobal(simHit->localPosition());
-    double x = globalPosition.x();
-    double y = globalPosition.y();
-    double z = globalPosition.z();
-    double r = sqrt(globalPosition.x() * globalPosition.x() + globalPosition.y() * globalPosition.y());
-
-    // Find the corresponding SimTrack
-    auto trackId = simHit->trackId();
-    auto simTrack = std::find_if(G4TrkContainer->begin(), G4TrkContainer->end(), [trackId](const SimTrack& track) {
-      return static_cast<decltype(trackId)>(track.trackId()) == trackId;
-    });
-
-    if (simTrack != G4TrkContainer->end()) {
-      // Get the particle type that caused the hit
-      int particleType = simTrack->type();
-
-      // Get the momentum of the particle that caused the hit
-      auto momentum = simTrack->momentum();
-
-      // Log the information
-      csv << evtcount << "," << energyDeposit << "," << x << "," << y << "," << z << "," << r << "," << particleType << ',' << momentum.E() << ',' << momentum.Px() << ',' << momentum.Py() << ',' << momentum.Pz() << '\n';
+  // Gen particles, only needed for the R-hadron directions of the ROI
+  edm::Handle<vector<reco::GenParticle>> genParticles;
+  if (roiMode_) {
+    iEvent.getByToken(genParticlesToken_, genParticles);
+    if (!genParticles.isValid()) {
+      edm::LogError("SpikedRHadronAnalyzer::analyze") << "Unable to find genParticles in event!";
+      return;
     }
   }
+  productsTimer.stop();
+
+  // Index the SimTracks once, every subdetector loop below looks its hits up in it
+  ScopedStageTimer truthTimer(profiler, AnalyzerStage::Truth);
+  SimTrackIndex& trackIndex = streamCache(streamID)->trackIndex;
+  trackIndex.build(*G4TrkContainer);
+
+  // Walk the track/vertex parent chains once, every hit is then tagged with its R-hadron and parent PDG
+  SimTruthGraph& truth = streamCache(streamID)->truth;
+  truth.build(trackIndex, *G4TrkContainer, *G4VtxContainer);
+  truthTimer.addHits(G4TrkContainer->size());
+  truthTimer.stop();
+
+  // Geometry of the current run
+  const RunGeometryCache* geometry = runCache(iEvent.getRun().index());
+
+  // Hits for this event are collected in a pooled record and handed to the output thread once the event is complete
+  std::unique_ptr<EventRecord> record = output_->acquire();
+  record->event = evtcount;
+  HitColumns& hits = record->hits;
+
+  // Momenta of the two R-hadrons at production, kept in the index of the hit file
+  for (std::uint8_t n = 1; n <= 2; ++n) {
+    const int position = truth.rHadronPosition(n);
+    if (position < 0) continue;
+    const auto& momentum = (*G4TrkContainer)[position].momentum();
+    record->rHadronMomentum[n - 1] = {{static_cast<float>(momentum.Px()), static_cast<float>(momentum.Py()), static_cast<float>(momentum.Pz()), static_cast<float>(momentum.E())}};
+  }
 
-  // Begin loop over calo hits
-  for (auto caloHit = G4CaloHitContainer.begin(); caloHit != G4CaloHitContainer.end(); ++caloHit) {
-    // Get the energy deposited
-    double energyDeposit = caloHit->energy();
-
-    // Get the location (r and z) of the hit
-    DetId detId = DetId(caloHit->id());
-    const GlobalPoint globalPosition = caloGeometry->getPosition(detId);
-    double x = globalPosition.x();
-    double y = globalPosition.y();
-    double z = globalPosition.z();
-    double r = sqrt(globalPosition.x() * globalPosition.x() + globalPosition.y() * globalPosition.y());
-
-    // Find the corresponding SimTrack
-    auto trackId = caloHit->geantTrackId();
-    auto simTrack = std::find_if(G4TrkContainer->begin(), G4TrkContainer->end(), [trackId](const SimTrack& track) {
-      return static_cast<decltype(trackId)>(track.trackId()) == trackId;
-    });
-
-    if (simTrack != G4TrkContainer->end()) {
-      // Get the particle type that caused the hit
-      int particleType = simTrack->type();
-
-      // Get the momentum of the particle that caused the hit
-      auto momentum = simTrack->momentum();
-
-      // Log the information
-      csv << evtcount << "," << energyDeposit << "," << x << "," << y << "," << z << "," << r << "," << particleType << ',' << momentum.E() << ',' << momentum.Px() << ',' << momentum.Py() << ',' << momentum.Pz() << '\n';
-    }
+  // Every subdetector goes through the same kernel, hits are placed in DetId order and written in their own order
+  StreamBuffer& buffer = *streamCache(streamID);
+  ScopedStageTimer trackerTimer(profiler, AnalyzerStage::Tracker);
+  trackerTimer.addHits(G4SimHitContainer.size());
+  trackerTimer.addDropped(buffer.trackerHits.process(G4SimHitContainer, *geometry, trackIndex, truth, hits));
+  trackerTimer.stop();
+
+  ScopedStageTimer ecalTimer(profiler, AnalyzerStage::Ecal);
+  ecalTimer.addHits(G4CaloHitContainer.size());
+  ecalTimer.addDropped(buffer.ecalHits.process(G4CaloHitContainer, *geometry, trackIndex, truth, hits));
+  ecalTimer.stop();
+
+  ScopedStageTimer hcalTimer(profiler, AnalyzerStage::Hcal);
+  hcalTimer.addHits(HcalContainer->size());
+  hcalTimer.addDropped(buffer.hcalHits.process(*HcalContainer, *geometry, trackIndex, truth, hits));
+  hcalTimer.stop();
+
+  ScopedStageTimer muonTimer(profiler, AnalyzerStage::Muon);
+  muonTimer.addHits(G4MuonContainer.size());
+  muonTimer.addDropped(buffer.muonHits.process(G4MuonContainer, *geometry, trackIndex, truth, hits));
+  muonTimer.stop();
+
+  // In ROI mode only the hits near the gen-level R-hadrons, or above the energy threshold, go on to the output
+  HitRoiFilter* roiFilter = streamCache(streamID)->roiFilter.get();
+  if (roiFilter) {
+    ScopedStageTimer roiTimer(profiler, AnalyzerStage::Roi);
+    roiTimer.addHits(hits.size());
+    std::array<HitRoiFilter::Direction, 2> directions;
+    const std::size_t nDirections = rHadronDirections(*genParticles, directions);
+    roiTimer.addDropped(roiFilter->prune(hits, directions.data(), nDirections));
   }
 
-  // Begin loop over muon chamber sim hits
-  for (auto muonHit = G4MuonContainer.begin(); muonHit != G4MuonContainer.end(); ++muonHit) {
-    // Get the energy deposited
-    double energyDeposit = muonHit->energyLoss();
-
-    // Get the location (r and z) of the hit
-    DetId detId = DetId(muonHit->detUnitId());
-    GlobalPoint globalPosition;
-
-    // Determine the subdetector and get the global position
-    if (detId.subdetId() == MuonSubdetId::CSC) {
-      const GeomDetUnit *det = (const GeomDetUnit *)cscGeometry->idToDetUnit(detId);
-      globalPosition = det->toGlobal(muonHit->localPosition());
-    } else if (detId.subdetId() == MuonSubdetId::DT) {
-      const GeomDetUnit *det = (const GeomDetUnit *)dtGeometry->idToDetUnit(detId);
-      globalPosition = det->toGlobal(muonHit->localPosition());
-    } else if (detId.subdetId() == MuonSubdetId::RPC) {
-      const GeomDetUnit *det = (const GeomDetUnit *)rpcGeometry->idToDetUnit(detId);
-      globalPosition = det->toGlobal(muonHit->localPosition());
-    } else if (detId.subdetId() == MuonSubdetId::GEM) {
-      const GeomDetUnit *det = (const GeomDetUnit *)gemGeometry->idToDetUnit(detId);
-      globalPosition = det->toGlobal(muonHit->localPosition());
-    } else continue;
-
-    double x = globalPosition.x();
-    double y = globalPosition.y();
-    double z = globalPosition.z();
-    double r = sqrt(globalPosition.x() * globalPosition.x() + globalPosition.y() * globalPosition.y());
-
-    // Find the corresponding SimTrack
-    auto trackId = muonHit->trackId();
-    auto simTrack = std::find_if(G4TrkContainer->begin(), G4TrkContainer->end(), [trackId](const SimTrack& track) {
-      return static_cast<decltype(trackId)>(track.trackId()) == trackId;
-    });
-
-    if (simTrack != G4TrkContainer->end()) {
-      // Get the particle type that caused the hit
-      int particleType = simTrack->type();
-
-      // Get the momentum of the particle that caused the hit
-      auto momentum = simTrack->momentum();
-
-      // Log the information
-      csv << evtcount << "," << energyDeposit << "," << x << "," << y << "," << z << "," << r << "," << particleType << ',' << momentum.E() << ',' << momentum.Px() << ',' << momentum.Py() << ',' << momentum.Pz() << '\n';
-    }
+  // In summary mode only the aggregated event is kept, the hits are dropped here
+  const std::size_t nHits = hits.size();
+  HitAggregator* aggregator = streamCache(streamID)->aggregator.get();
+  if (aggregator) {
+    ScopedStageTimer summaryTimer(profiler, AnalyzerStage::Summary);
+    summaryTimer.addHits(nHits);
+    aggregator->fill(hits, record->summary);
+    hits.clear();
+  }
+
+  ScopedStageTimer outputTimer(profiler, AnalyzerStage::Output);
+  outputTimer.addHits(nHits);
+  const std::size_t bytes = output_->push(std::move(record));
+  outputTimer.stop();
+  if (profiler)
+    profiler->recordEvent(eventTimer.stop(), nHits, bytes);
+}
+
+void SpikedRHadronAnalyzer::beginJob() {
+  jobStart_ = StageProfiler::Clock::now();
+}
+
+void SpikedRHadronAnalyzer::endJob() {
+  output_->close();
+  if (output_->stalls() > 0)
+    edm::LogInfo("SpikedRHadronAnalyzer") << "The event loop waited " << output_->stalls()
+                                           << " times for the output thread, consider a larger outputQueueSize";
+  if (profileFile_.empty())
+    return;
+
+  const double wallSeconds = std::chrono::duration<double>(StageProfiler::Clock::now() - jobStart_).count();
+  std::ofstream json(profileFile_);
+  if (!json) {
+    edm::LogError("SpikedRHadronAnalyzer") << "Unable to write the profile to " << profileFile_;
+    return;
   }
+  jobProfile_.writeJson(json, wallSeconds, profiledStreams_);
+  edm::LogInfo("SpikedRHadronAnalyzer") << "Stage profile of " << jobProfile_.events() << " events written to " << profileFile_;
 }
 
 //define this as a plug-in
@@ -0,0 +1,142 @@
+// -*- C++ -*-
+//
+// Package:    SpikedRHadronAnalyzer
+// Class:      SpikedRHadronEventSelector
+//
+/**\class SpikedRHadronEventSelector src/SpikedRHadronEventSelector.cc
+
+ Description: [Selects the events passed to SpikedRHadronAnalyzer: event number lists/ranges, a random prescale and a gen-level R-hadron cut]
+
+ Implementation:
+     [Runs upstream of the analyzer on the same path, so rejected events never read the SimHit collections.
+      The prescale is a hash of the seed and the event id, which keeps it reproducible for any number of threads.
+      The gen-level cut only consumes the gen particles when it is enabled.]
+*/
+
+//System include files
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+//Framework
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/global/EDFilter.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
+#include "FWCore/Utilities/interface/InputTag.h"
+#include "DataFormats/HepMCCandidate/interface/GenParticle.h"
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/SimTruthGraph.h"
+
+class SpikedRHadronEventSelector : public edm::global::EDFilter<> {
+public:
+  explicit SpikedRHadronEventSelector(const edm::ParameterSet&);
+
+private:
+  bool filter(edm::StreamID, edm::Event&, const edm::EventSetup&) const override;
+
+  bool inEventRanges(edm::EventNumber_t event) const;
+  bool passesPrescale(const edm::EventID& id) const;
+  bool passesGenSelection(const edm::Event& iEvent) const;
+
+  // Inclusive event number ranges, empty means every event
+  std::vector<std::pair<edm::EventNumber_t, edm::EventNumber_t>> eventRanges_;
+
+  unsigned int prescale_;
+  std::uint64_t prescaleSeed_;
+
+  edm::EDGetTokenT<std::vector<reco::GenParticle>> genParticlesToken_;
+  unsigned int minRHadrons_;
+  double minRHadronPt_;
+  double maxRHadronEta_;
+};
+
+//constructor
+SpikedRHadronEventSelector::SpikedRHadronEventSelector(const edm::ParameterSet& iConfig)
+    : prescale_(iConfig.getParameter<unsigned int>("prescale")),
+      prescaleSeed_(iConfig.getParameter<unsigned int>("prescaleSeed")),
+      minRHadrons_(iConfig.getParameter<unsigned int>("minRHadrons")),
+      minRHadronPt_(iConfig.getParameter<double>("minRHadronPt")),
+      maxRHadronEta_(iConfig.getParameter<double>("maxRHadronEta")) {
+
+  // Ranges are written as "first-last" or as a single event number
+  for (const auto& range : iConfig.getParameter<std::vector<std::string>>("eventRanges")) {
+    if (range.empty())
+      continue;
+    try {
+      const auto dash = range.find('-');
+      const edm::EventNumber_t first = std::stoull(range.substr(0, dash));
+      const edm::EventNumber_t last = dash == std::string::npos ? first : std::stoull(range.substr(dash + 1));
+      if (last < first)
+        throw std::invalid_argument(range);
+      eventRanges_.emplace_back(first, last);
+    } catch (const std::logic_error&) {
+      throw cms::Exception("Configuration") << "SpikedRHadronEventSelector: invalid event range '" << range << "'";
+    }
+  }
+
+  if (prescale_ == 0)
+    throw cms::Exception("Configuration") << "SpikedRHadronEventSelector: prescale must be at least 1";
+
+  if (minRHadrons_ > 0)
+    genParticlesToken_ = consumes<std::vector<reco::GenParticle>>(iConfig.getParameter<edm::InputTag>("gen_info"));
+}
+
+bool SpikedRHadronEventSelector::filter(edm::StreamID, edm::Event& iEvent, const edm::EventSetup&) const {
+  // Cheapest checks first, the gen particles are only read for events that survive the others
+  if (!inEventRanges(iEvent.id().event()))
+    return false;
+  if (!passesPrescale(iEvent.id()))
+    return false;
+  return minRHadrons_ == 0 || passesGenSelection(iEvent);
+}
+
+bool SpikedRHadronEventSelector::inEventRanges(edm::EventNumber_t event) const {
+  if (eventRanges_.empty())
+    return true;
+  for (const auto& range : eventRanges_) {
+    if (event >= range.first && event <= range.second)
+      return true;
+  }
+  return false;
+}
+
+bool SpikedRHadronEventSelector::passesPrescale(const edm::EventID& id) const {
+  if (prescale_ == 1)
+    return true;
+
+  // splitmix64 of the seed and the event id, uniform enough to keep one event in prescale_
+  std::uint64_t hash = prescaleSeed_ ^ (static_cast<std::uint64_t>(id.run()) << 48) ^
+                       (static_cast<std::uint64_t>(id.luminosityBlock()) << 32) ^ id.event();
+  hash += 0x9E3779B97F4A7C15ULL;
+  hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+  hash ^= hash >> 31;
+  return hash % prescale_ == 0;
+}
+
+bool SpikedRHadronEventSelector::passesGenSelection(const edm::Event& iEvent) const {
+  edm::Handle<std::vector<reco::GenParticle>> genParticles;
+  iEvent.getByToken(genParticlesToken_, genParticles);
+  if (!genParticles.isValid())
+    throw cms::Exception("ProductNotFound") << "SpikedRHadronEventSelector: gen particles not found in event";
+
+  unsigned int nRHadrons = 0;
+  for (const auto& particle : *genParticles) {
+    // Final state gluino and stop R-hadrons
+    if (particle.status() != 1 || !SimTruthGraph::isRHadron(particle.pdgId()))
+      continue;
+    if (particle.pt() < minRHadronPt_ || std::abs(particle.eta()) > maxRHadronEta_)
+      continue;
+    if (++nRHadrons >= minRHadrons_)
+      return true;
+  }
+  return false;
+}
+
+//define this as a plug-in
+DEFINE_FWK_MODULE(SpikedRHadronEventSelector);
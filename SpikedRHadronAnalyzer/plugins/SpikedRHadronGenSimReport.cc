@@ -0,0 +1,155 @@
+// -*- C++ -*-
+//
+// Package:    SpikedRHadronAnalyzer
+// Class:      SpikedRHadronGenSimReport
+//
+/**\class SpikedRHadronGenSimReport src/SpikedRHadronGenSimReport.cc
+
+ Description: [End-of-job GEN-SIM report: R-hadron pair filter efficiency, time per accepted event and Geant4 time per R-hadron species]
+
+ Implementation:
+     [Runs at the end of the simulation path, after the pair filter and g4SimHits, so it only sees
+      accepted events. The event and Geant4 times come from the SpikedRHadronGenSimTimer service.
+      The Geant4 time of an event is attributed to every R-hadron species present in it. The report
+      is printed with LogPrint and can also be written as JSON, which submitColbyProdToCondor.py
+      reads to size jobs by accepted events.]
+*/
+
+//System include files
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+//Framework
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/global/EDAnalyzer.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/ServiceRegistry/interface/Service.h"
+#include "FWCore/Utilities/interface/Exception.h"
+#include "FWCore/Utilities/interface/InputTag.h"
+#include "DataFormats/HepMCCandidate/interface/GenParticle.h"
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/SimTruthGraph.h"
+
+#include "SpikedRHadronGenSimTimer.h"
+
+class SpikedRHadronGenSimReport : public edm::global::EDAnalyzer<> {
+public:
+  explicit SpikedRHadronGenSimReport(const edm::ParameterSet&);
+
+private:
+  void analyze(edm::StreamID, const edm::Event&, const edm::EventSetup&) const override;
+  void endJob() override;
+
+  void writeJson(std::uint64_t generated, double loopSeconds, double summedSeconds) const;
+
+  edm::EDGetTokenT<std::vector<reco::GenParticle>> genParticlesToken_;
+  int massPoint_;
+  std::string reportFile_;
+
+  struct Species {
+    std::uint64_t events = 0;
+    double simulationSeconds = 0.;
+  };
+
+  // Updated once per accepted event, which takes seconds to simulate, so a mutex is cheap enough
+  mutable std::mutex mutex_;
+  mutable std::uint64_t accepted_ = 0;
+  mutable double simulationSeconds_ = 0.;
+  mutable std::map<int, Species> species_;
+};
+
+//constructor
+SpikedRHadronGenSimReport::SpikedRHadronGenSimReport(const edm::ParameterSet& iConfig)
+    : genParticlesToken_(consumes<std::vector<reco::GenParticle>>(iConfig.getParameter<edm::InputTag>("gen_info"))),
+      massPoint_(iConfig.getParameter<int>("massPoint")),
+      reportFile_(iConfig.getParameter<std::string>("reportFile")) {
+  if (!edm::Service<SpikedRHadronGenSimTimer>().isAvailable())
+    throw cms::Exception("Configuration") << "SpikedRHadronGenSimReport needs the SpikedRHadronGenSimTimer service";
+}
+
+void SpikedRHadronGenSimReport::analyze(edm::StreamID streamID, const edm::Event& iEvent, const edm::EventSetup&) const {
+  const double simulationSeconds = edm::Service<SpikedRHadronGenSimTimer>()->simulationSeconds(streamID);
+
+  edm::Handle<std::vector<reco::GenParticle>> genParticles;
+  iEvent.getByToken(genParticlesToken_, genParticles);
+
+  // Final state R-hadron species of the event, same PDG codes as SpikedRHadronEventSelector
+  std::set<int> species;
+  if (genParticles.isValid()) {
+    for (const auto& particle : *genParticles) {
+      if (particle.status() == 1 && SimTruthGraph::isRHadron(particle.pdgId()))
+        species.insert(std::abs(particle.pdgId()));
+    }
+  }
+
+  std::lock_guard<std::mutex> guard(mutex_);
+  ++accepted_;
+  simulationSeconds_ += simulationSeconds;
+  for (const int pdg : species) {
+    Species& entry = species_[pdg];
+    ++entry.events;
+    entry.simulationSeconds += simulationSeconds;
+  }
+}
+
+void SpikedRHadronGenSimReport::endJob() {
+  const SpikedRHadronGenSimTimer& timer = *edm::Service<SpikedRHadronGenSimTimer>();
+  const std::uint64_t generated = timer.events();
+  const double loopSeconds = timer.eventLoopSeconds();
+  const double summedSeconds = timer.summedEventSeconds();
+
+  edm::LogPrint report("SpikedRHadronGenSimReport");
+  report << "GEN-SIM report for M = " << massPoint_ << " GeV\n"
+         << "  generated events:            " << generated << "\n"
+         << "  accepted by the pair filter: " << accepted_ << "\n"
+         << "  filter efficiency:           " << (generated > 0 ? double(accepted_) / generated : 0.) << "\n"
+         << "  event loop wall time:        " << loopSeconds << " s\n";
+  if (accepted_ > 0) {
+    report << "  wall time per accepted event: " << loopSeconds / accepted_ << " s\n"
+           << "  event time per accepted event (all streams): " << summedSeconds / accepted_ << " s\n"
+           << "  Geant4 time per accepted event: " << simulationSeconds_ / accepted_ << " s\n";
+  }
+  report << "  Geant4 time per R-hadron species (events containing it, mean time per event):\n";
+  for (const auto& entry : species_) {
+    report << "    " << entry.first << ": " << entry.second.events << " events, "
+           << entry.second.simulationSeconds / entry.second.events << " s\n";
+  }
+
+  if (!reportFile_.empty())
+    writeJson(generated, loopSeconds, summedSeconds);
+}
+
+void SpikedRHadronGenSimReport::writeJson(std::uint64_t generated, double loopSeconds, double summedSeconds) const {
+  std::ofstream json(reportFile_);
+  if (!json) {
+    edm::LogError("SpikedRHadronGenSimReport") << "Unable to write the report to " << reportFile_;
+    return;
+  }
+  json << "{\n"
+       << "  \"mass\": " << massPoint_ << ",\n"
+       << "  \"generatedEvents\": " << generated << ",\n"
+       << "  \"acceptedEvents\": " << accepted_ << ",\n"
+       << "  \"filterEfficiency\": " << (generated > 0 ? double(accepted_) / generated : 0.) << ",\n"
+       << "  \"eventLoopSeconds\": " << loopSeconds << ",\n"
+       << "  \"summedEventSeconds\": " << summedSeconds << ",\n"
+       << "  \"simulationSeconds\": " << simulationSeconds_ << ",\n"
+       << "  \"species\": {";
+  const char* separator = "\n";
+  for (const auto& entry : species_) {
+    json << separator << "    \"" << entry.first << "\": {\"events\": " << entry.second.events
+         << ", \"simulationSeconds\": " << entry.second.simulationSeconds << "}";
+    separator = ",\n";
+  }
+  json << "\n  }\n}\n";
+}
+
+//define this as a plug-in
+DEFINE_FWK_MODULE(SpikedRHadronGenSimReport);
@@ -0,0 +1,88 @@
+#include "SpikedRHadronGenSimTimer.h"
+
+#include <algorithm>
+
+#include "FWCore/ParameterSet/interface/ConfigurationDescriptions.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/ParameterSet/interface/ParameterSetDescription.h"
+#include "FWCore/ServiceRegistry/interface/ActivityRegistry.h"
+#include "FWCore/ServiceRegistry/interface/ModuleCallingContext.h"
+#include "FWCore/ServiceRegistry/interface/ServiceMaker.h"
+#include "FWCore/ServiceRegistry/interface/StreamContext.h"
+#include "FWCore/ServiceRegistry/interface/SystemBounds.h"
+#include "DataFormats/Provenance/interface/ModuleDescription.h"
+
+namespace {
+  double seconds(std::chrono::steady_clock::duration duration) { return std::chrono::duration<double>(duration).count(); }
+}
+
+SpikedRHadronGenSimTimer::SpikedRHadronGenSimTimer(const edm::ParameterSet& iConfig, edm::ActivityRegistry& iRegistry)
+    : simulationModule_(iConfig.getUntrackedParameter<std::string>("simulationModule")) {
+  iRegistry.watchPreallocate(this, &SpikedRHadronGenSimTimer::preallocate);
+  iRegistry.watchPostModuleConstruction(this, &SpikedRHadronGenSimTimer::postModuleConstruction);
+  iRegistry.watchPreEvent(this, &SpikedRHadronGenSimTimer::preEvent);
+  iRegistry.watchPostEvent(this, &SpikedRHadronGenSimTimer::postEvent);
+  iRegistry.watchPreModuleEvent(this, &SpikedRHadronGenSimTimer::preModuleEvent);
+  iRegistry.watchPostModuleEvent(this, &SpikedRHadronGenSimTimer::postModuleEvent);
+}
+
+void SpikedRHadronGenSimTimer::fillDescriptions(edm::ConfigurationDescriptions& descriptions) {
+  edm::ParameterSetDescription desc;
+  desc.addUntracked<std::string>("simulationModule", "g4SimHits");
+  descriptions.add("SpikedRHadronGenSimTimer", desc);
+}
+
+std::uint64_t SpikedRHadronGenSimTimer::events() const {
+  std::lock_guard<std::mutex> guard(totalsMutex_);
+  return events_;
+}
+
+double SpikedRHadronGenSimTimer::eventLoopSeconds() const {
+  std::lock_guard<std::mutex> guard(totalsMutex_);
+  return events_ == 0 ? 0. : seconds(lastEventEnd_ - firstEventStart_);
+}
+
+double SpikedRHadronGenSimTimer::summedEventSeconds() const {
+  std::lock_guard<std::mutex> guard(totalsMutex_);
+  return summedEventSeconds_;
+}
+
+void SpikedRHadronGenSimTimer::preallocate(const edm::service::SystemBounds& bounds) {
+  streams_.resize(bounds.maxNumberOfStreams());
+}
+
+void SpikedRHadronGenSimTimer::postModuleConstruction(const edm::ModuleDescription& description) {
+  if (description.moduleLabel() == simulationModule_)
+    simulationModuleId_ = description.id();
+}
+
+void SpikedRHadronGenSimTimer::preEvent(const edm::StreamContext& iContext) {
+  StreamTiming& stream = streams_[iContext.streamID().value()];
+  stream.eventStart = Clock::now();
+  stream.simulationSeconds = 0.;
+}
+
+void SpikedRHadronGenSimTimer::postEvent(const edm::StreamContext& iContext) {
+  const Clock::time_point now = Clock::now();
+  const StreamTiming& stream = streams_[iContext.streamID().value()];
+
+  std::lock_guard<std::mutex> guard(totalsMutex_);
+  ++events_;
+  summedEventSeconds_ += seconds(now - stream.eventStart);
+  firstEventStart_ = std::min(firstEventStart_, stream.eventStart);
+  lastEventEnd_ = std::max(lastEventEnd_, now);
+}
+
+void SpikedRHadronGenSimTimer::preModuleEvent(const edm::StreamContext& iContext, const edm::ModuleCallingContext& iModule) {
+  if (iModule.moduleDescription()->id() == simulationModuleId_)
+    streams_[iContext.streamID().value()].moduleStart = Clock::now();
+}
+
+void SpikedRHadronGenSimTimer::postModuleEvent(const edm::StreamContext& iContext, const edm::ModuleCallingContext& iModule) {
+  if (iModule.moduleDescription()->id() != simulationModuleId_)
+    return;
+  StreamTiming& stream = streams_[iContext.streamID().value()];
+  stream.simulationSeconds += seconds(Clock::now() - stream.moduleStart);
+}
+
+DEFINE_FWK_SERVICE(SpikedRHadronGenSimTimer);
@@ -0,0 +1,76 @@
+#ifndef RHadronProduction_SpikedRHadronAnalyzer_SpikedRHadronGenSimTimer_h
+#define RHadronProduction_SpikedRHadronAnalyzer_SpikedRHadronGenSimTimer_h
+
+/**\class SpikedRHadronGenSimTimer SpikedRHadronGenSimTimer.h
+
+ Description: [Service timing the GEN-SIM event loop and the Geant4 module of each event, read by SpikedRHadronGenSimReport]
+
+ Implementation:
+     [Watches the event and module transitions of the ActivityRegistry. The simulation module is
+      recognised by its label when it is constructed. Each stream only writes its own slot, so the
+      module transitions take no lock. The job totals are updated once per event under a mutex.]
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "FWCore/Utilities/interface/StreamID.h"
+
+namespace edm {
+  class ActivityRegistry;
+  class ConfigurationDescriptions;
+  class ModuleCallingContext;
+  class ModuleDescription;
+  class ParameterSet;
+  class StreamContext;
+  namespace service {
+    class SystemBounds;
+  }
+}
+
+class SpikedRHadronGenSimTimer {
+public:
+  SpikedRHadronGenSimTimer(const edm::ParameterSet&, edm::ActivityRegistry&);
+
+  static void fillDescriptions(edm::ConfigurationDescriptions& descriptions);
+
+  // Time spent in the simulation module by the event currently processed on this stream, 0 if it did not run
+  double simulationSeconds(edm::StreamID streamID) const { return streams_[streamID.value()].simulationSeconds; }
+
+  // Job totals, complete once the last event has finished
+  std::uint64_t events() const;
+  double eventLoopSeconds() const;    // wall time from the start of the first event to the end of the last
+  double summedEventSeconds() const;  // sum of the event times of all streams
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  void preallocate(const edm::service::SystemBounds&);
+  void postModuleConstruction(const edm::ModuleDescription&);
+  void preEvent(const edm::StreamContext&);
+  void postEvent(const edm::StreamContext&);
+  void preModuleEvent(const edm::StreamContext&, const edm::ModuleCallingContext&);
+  void postModuleEvent(const edm::StreamContext&, const edm::ModuleCallingContext&);
+
+  struct StreamTiming {
+    Clock::time_point eventStart;
+    Clock::time_point moduleStart;
+    double simulationSeconds = 0.;
+  };
+
+  std::string simulationModule_;
+  unsigned int simulationModuleId_ = std::numeric_limits<unsigned int>::max();
+  std::vector<StreamTiming> streams_;
+
+  mutable std::mutex totalsMutex_;
+  std::uint64_t events_ = 0;
+  double summedEventSeconds_ = 0.;
+  Clock::time_point firstEventStart_ = Clock::time_point::max();
+  Clock::time_point lastEventEnd_ = Clock::time_point::min();
+};
+
+#endif
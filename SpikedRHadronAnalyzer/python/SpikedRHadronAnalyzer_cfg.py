@@ -14,8 +14,95 @@ from Configuration.AlCa.GlobalTag import GlobalTag
 process.GlobalTag.globaltag = "106X_mcRun3_2021_realistic_v3"
 
 options = VarParsing('analysis')
+options.register('numberOfThreads', 1,
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.int,
+    "Number of threads used by cmsRun"
+)
+options.register('numberOfStreams', 0,
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.int,
+    "Number of concurrent events (0 means one per thread)"
+)
+options.register('outputFormat', 'csv',
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.string,
+    "Format of the hit dump: 'csv' or 'root' (flat TTree with typed branches)"
+)
+options.register('outputMode', 'hits',
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.string,
+    "'hits' writes every hit, 'summary' only writes per-event energy sums per DetId, energy histograms per PDG and subdetector, and an eta-phi grid"
+)
+options.register('eventRanges', '',
+    VarParsing.multiplicity.list,
+    VarParsing.varType.string,
+    "Event numbers to analyze, as 'first-last' ranges or single numbers (empty means all events)"
+)
+options.setDefault('eventRanges', ['1-10', '539'])
+options.register('prescale', 1,
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.int,
+    "Keep one event in N, chosen randomly but reproducibly from prescaleSeed"
+)
+options.register('prescaleSeed', 12345,
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.int,
+    "Seed of the random prescale"
+)
+options.register('minRHadrons', 0,
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.int,
+    "Minimum number of gen-level R-hadrons passing the pt/eta cuts (0 disables the gen-level cut)"
+)
+options.register('minRHadronPt', 0.,
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.float,
+    "Minimum gen-level R-hadron pt [GeV]"
+)
+options.register('maxRHadronEta', 100.,
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.float,
+    "Maximum gen-level R-hadron |eta|"
+)
+options.register('genProcess', 'SIM',
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.string,
+    "Process that produced the gen particles: 'SIM' for GEN-SIM files, 'HLT' for the RECO files of the fused production"
+)
+options.register('roiMode', False,
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.bool,
+    "Only write the hits within a cone around the two gen-level R-hadrons, or above roiEnergyThreshold"
+)
+options.register('roiConeSize', 0.5,
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.float,
+    "Delta R of the ROI cones, in every subdetector"
+)
+options.register('roiEnergyThreshold', 0.,
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.float,
+    "Hits at or above this energy [GeV] are kept outside the ROI cones too (0 disables it)"
+)
+options.register('profileFile', '',
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.string,
+    "JSON file for the per-stage timers and counters of the analyzer (empty disables them)"
+)
+options.register('wantSummary', False,
+    VarParsing.multiplicity.singleton,
+    VarParsing.varType.bool,
+    "Print the framework TimeReport with the per-event time of the analyzer"
+)
 options.parseArguments()
 
+process.options = cms.untracked.PSet(
+    numberOfThreads = cms.untracked.uint32(options.numberOfThreads),
+    numberOfStreams = cms.untracked.uint32(options.numberOfStreams),
+    wantSummary = cms.untracked.bool(options.wantSummary)
+)
+
 #process.maxEvents = cms.untracked.PSet( input = cms.untracked.int32(5000) )
 process.maxEvents = cms.untracked.PSet( input = cms.untracked.int32(-1) )
 
@@ -23,12 +110,46 @@ process.source = cms.Source("PoolSource",
     fileNames = cms.untracked.vstring(options.inputFiles)
 )
 
-outputFileName = options.outputFile.replace(".root", "")
+outputFileName = options.outputFile
+if options.outputFormat != "root":
+    outputFileName = outputFileName.replace(".root", "")
+
+# Event selection runs before the analyzer, rejected events never read the SimHit collections
+process.selector = cms.EDFilter("SpikedRHadronEventSelector",
+    eventRanges = cms.vstring(options.eventRanges),
+    prescale = cms.uint32(options.prescale),
+    prescaleSeed = cms.uint32(options.prescaleSeed),
+    gen_info = cms.InputTag("genParticles","",options.genProcess),
+    minRHadrons = cms.uint32(options.minRHadrons),
+    minRHadronPt = cms.double(options.minRHadronPt),
+    maxRHadronEta = cms.double(options.maxRHadronEta),
+)
 
 process.demo = cms.EDAnalyzer("SpikedRHadronAnalyzer",
 
     outputFileName = cms.string(outputFileName),
-    gen_info = cms.InputTag("genParticles","","SIM"),
+    outputFormat = cms.string(options.outputFormat),
+    outputMode = cms.string(options.outputMode),
+    outputQueueSize = cms.uint32(64), # events waiting for the output thread before the event loop is held back
+    profileFile = cms.string(options.profileFile),
+
+    # Binning of the summaries written in outputMode 'summary', energies in GeV and log-binned
+    summaryEtaBins = cms.uint32(50),
+    summaryEtaMin = cms.double(-5.),
+    summaryEtaMax = cms.double(5.),
+    summaryPhiBins = cms.uint32(72),
+    summaryEnergyBins = cms.uint32(50),
+    summaryEnergyMin = cms.double(1e-6),
+    summaryEnergyMax = cms.double(1e4),
+
+    # Region of interest around the gen-level R-hadrons, cone sizes in Delta R per subdetector group and energy in GeV
+    roiMode = cms.bool(options.roiMode),
+    roiTrackerCone = cms.double(options.roiConeSize),
+    roiEcalCone = cms.double(options.roiConeSize),
+    roiHcalCone = cms.double(options.roiConeSize),
+    roiMuonCone = cms.double(options.roiConeSize),
+    roiEnergyThreshold = cms.double(options.roiEnergyThreshold),
+    gen_info = cms.InputTag("genParticles","",options.genProcess),
 
     G4TrkSrc = cms.InputTag("g4SimHits"),
     G4VtxSrc = cms.InputTag("g4SimHits"),
@@ -52,6 +173,7 @@ process.demo = cms.EDAnalyzer("SpikedRHadronAnalyzer",
     EcalHitsEE = cms.InputTag("g4SimHits","EcalHitsEE"),
     EcalHitsES = cms.InputTag("g4SimHits","EcalHitsES"),
     HcalHits = cms.InputTag("g4SimHits","HcalHits"),
+    HcalTestNumbering = cms.bool(True), # Run 2 2017+ sim hits use the HCAL test numbering and are relabelled
 
     # Muon
     MuonCSCHits = cms.InputTag("g4SimHits","MuonCSCHits"),
@@ -60,4 +182,4 @@ process.demo = cms.EDAnalyzer("SpikedRHadronAnalyzer",
     MuonGEMHits = cms.InputTag("g4SimHits","MuonGEMHits"),
 )
 
-process.p = cms.Path(process.demo)
+process.p = cms.Path(process.selector + process.demo)
@@ -0,0 +1,21 @@
+import FWCore.ParameterSet.Config as cms
+from FWCore.ParameterSet.VarParsing import VarParsing
+
+# Merges the per-block outputs of a checkpointed production (see gensimToNTuple.sh) into one file,
+# in the order the input files are given, copying the events without running any module
+
+process = cms.Process("MERGE")
+
+options = VarParsing('analysis')
+options.parseArguments()
+
+process.source = cms.Source("PoolSource",
+    fileNames = cms.untracked.vstring(options.inputFiles),
+    duplicateCheckMode = cms.untracked.string('checkEachFile')
+)
+
+process.output = cms.OutputModule("PoolOutputModule",
+    fileName = cms.untracked.string(options.outputFile)
+)
+
+process.outputPath = cms.EndPath(process.output)
@@ -0,0 +1,115 @@
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/AsyncHitWriter.h"
+
+AsyncHitWriter::AsyncHitWriter(std::unique_ptr<HitWriter> writer, std::size_t queueSize)
+    : writer_(std::move(writer)), pending_(queueSize), pool_(2 * queueSize) {
+  thread_ = std::thread(&AsyncHitWriter::run, this);
+}
+
+AsyncHitWriter::~AsyncHitWriter() {
+  // Only reached without close() when the job failed, the output is left unfinished
+  if (thread_.joinable()) {
+    closing_.store(true, std::memory_order_release);
+    wakeWriter();
+    thread_.join();
+  }
+  EventRecord* record;
+  while (pending_.try_pop(record))
+    delete record;
+  while (pool_.try_pop(record))
+    delete record;
+}
+
+std::unique_ptr<EventRecord> AsyncHitWriter::acquire() {
+  EventRecord* record;
+  if (pool_.try_pop(record))
+    return std::unique_ptr<EventRecord>(record);
+  return std::make_unique<EventRecord>();
+}
+
+std::size_t AsyncHitWriter::push(std::unique_ptr<EventRecord> record) {
+  writer_->serialize(*record);
+  const std::size_t bytes = record->bytes();
+  EventRecord* raw = record.release();
+  if (!pending_.try_push(raw)) {
+    // The queue is full: sleep until the writer thread takes a record, re-checking under the lock
+    stalls_.fetch_add(1, std::memory_order_relaxed);
+    std::unique_lock<std::mutex> lock(mutex_);
+    pushersWaiting_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (!pending_.try_push(raw))
+      spaceFreed_.wait(lock);
+    pushersWaiting_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  // Wake the writer thread if it went to sleep on an empty queue
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (writerWaiting_.load(std::memory_order_relaxed))
+    wakeWriter();
+  return bytes;
+}
+
+void AsyncHitWriter::close() {
+  if (!thread_.joinable())
+    return;
+  closing_.store(true, std::memory_order_release);
+  wakeWriter();
+  thread_.join();
+  if (error_)
+    std::rethrow_exception(error_);
+  writer_->close();
+}
+
+void AsyncHitWriter::run() {
+  EventRecord* record;
+  while (true) {
+    // close() is only called once every stream has pushed its last event, so a queue still empty
+    // after the flag was seen is final. A record found here is written like any other.
+    const bool closing = closing_.load(std::memory_order_acquire);
+    if (pending_.try_pop(record)) {
+      wakePushers();
+      // After a failure the remaining events are only drained, so the streams never block on a dead writer
+      if (!error_) {
+        try {
+          writer_->write(*record);
+        } catch (...) {
+          error_ = std::current_exception();
+        }
+      }
+      release(record);
+      continue;
+    }
+    if (closing)
+      return;
+    waitForRecords();
+  }
+}
+
+void AsyncHitWriter::waitForRecords() {
+  // The flag is set before the queue is checked again, and push() checks the flag after queueing, so
+  // one of the two sees the other. A notify sent in between waits for the lock held here.
+  std::unique_lock<std::mutex> lock(mutex_);
+  writerWaiting_.store(true, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  while (pending_.empty() && !closing_.load(std::memory_order_acquire))
+    recordsQueued_.wait(lock);
+  writerWaiting_.store(false, std::memory_order_relaxed);
+}
+
+void AsyncHitWriter::wakeWriter() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  recordsQueued_.notify_one();
+}
+
+void AsyncHitWriter::wakePushers() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (pushersWaiting_.load(std::memory_order_relaxed) == 0)
+    return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  spaceFreed_.notify_all();
+}
+
+void AsyncHitWriter::release(EventRecord* record) {
+  record->clear();
+  if (!pool_.try_push(record))
+    delete record;
+}
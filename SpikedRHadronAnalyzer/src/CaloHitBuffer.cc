@@ -0,0 +1,62 @@
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/CaloHitBuffer.h"
+
+namespace {
+  // The arrays are parameters so that GCC takes the restrict qualifiers into account
+  void correct(std::size_t n,
+               const std::uint32_t* __restrict__ cell,
+               const float* __restrict__ cellX,
+               const float* __restrict__ cellY,
+               const float* __restrict__ cellZ,
+               const float* __restrict__ cellR,
+               const float* __restrict__ cellRespCorr,
+               float* __restrict__ energy,
+               float* __restrict__ x,
+               float* __restrict__ y,
+               float* __restrict__ z,
+               float* __restrict__ r) {
+    for (std::size_t i = 0; i < n; ++i) {
+      const std::uint32_t k = cell[i];
+      energy[i] *= cellRespCorr[k];
+      x[i] = cellX[k];
+      y[i] = cellY[k];
+      z[i] = cellZ[k];
+      r[i] = cellR[k];
+    }
+  }
+}
+
+void CaloHitBuffer::applyCorrections() {
+  const std::size_t n = energy.size();
+  x.resize(n);
+  y.resize(n);
+  z.resize(n);
+  r.resize(n);
+  correct(n,
+          cell.data(),
+          cellX.data(),
+          cellY.data(),
+          cellZ.data(),
+          cellR.data(),
+          cellRespCorr.data(),
+          energy.data(),
+          x.data(),
+          y.data(),
+          z.data(),
+          r.data());
+}
+
+void CaloHitBuffer::clear() {
+  cellX.clear();
+  cellY.clear();
+  cellZ.clear();
+  cellR.clear();
+  cellRespCorr.clear();
+  cell.clear();
+  detId.clear();
+  energy.clear();
+  time.clear();
+  x.clear();
+  y.clear();
+  z.clear();
+  r.clear();
+}
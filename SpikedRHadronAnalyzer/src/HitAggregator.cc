@@ -0,0 +1,129 @@
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitAggregator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "FWCore/Utilities/interface/Exception.h"
+
+void EventSummary::clear() {
+  detId.clear();
+  detIdSubDetector.clear();
+  detIdEnergy.clear();
+  histogramPdg.clear();
+  histogramSubDetector.clear();
+  histogramEnergyLow.clear();
+  histogramCount.clear();
+  cellSubDetector.clear();
+  cellEta.clear();
+  cellPhi.clear();
+  cellEnergy.clear();
+}
+
+HitAggregator::HitAggregator(const Config& config) : config_(config) {
+  if (config_.etaBins == 0 || config_.phiBins == 0 || config_.energyBins == 0 || config_.etaMax <= config_.etaMin ||
+      config_.energyMin <= 0.f || config_.energyMax <= config_.energyMin)
+    throw cms::Exception("Configuration") << "HitAggregator: invalid summary binning";
+
+  logEnergyMin_ = std::log10(config_.energyMin);
+  binsPerLogEnergy_ = config_.energyBins / (std::log10(config_.energyMax) - logEnergyMin_);
+  binsPerEta_ = config_.etaBins / (config_.etaMax - config_.etaMin);
+  binsPerPhi_ = config_.phiBins / (2.f * static_cast<float>(M_PI));
+  grid_.assign(kHitSubDetectors * config_.etaBins * config_.phiBins, 0.f);
+}
+
+std::uint64_t HitAggregator::histogramKey(std::int32_t pdg, std::uint8_t subDetector) {
+  return static_cast<std::uint64_t>(static_cast<std::uint32_t>(pdg)) << 8 | subDetector;
+}
+
+unsigned int HitAggregator::energyBin(float energy) const {
+  if (energy <= config_.energyMin)
+    return 0;
+  const int bin = static_cast<int>((std::log10(energy) - logEnergyMin_) * binsPerLogEnergy_);
+  return static_cast<unsigned int>(std::min(bin, static_cast<int>(config_.energyBins) - 1));
+}
+
+void HitAggregator::fill(const HitColumns& hits, EventSummary& summary) {
+  summary.clear();
+  const std::size_t n = hits.size();
+
+  // Summed energy per DetId. Sort keys hold the DetId in the high word and the hit in the low word,
+  // so the hits of a DetId are summed in their own order.
+  keys_.resize(n);
+  for (std::size_t i = 0; i < n; ++i)
+    keys_[i] = static_cast<std::uint64_t>(hits.detId[i]) << 32 | i;
+  std::sort(keys_.begin(), keys_.end());
+  for (std::size_t k = 0; k < n; ++k) {
+    const std::uint32_t detId = keys_[k] >> 32;
+    const std::size_t i = keys_[k] & 0xffffffff;
+    if (k == 0 || detId != summary.detId.back()) {
+      summary.detId.push_back(detId);
+      summary.detIdSubDetector.push_back(hits.subDetector[i]);
+      summary.detIdEnergy.push_back(0.f);
+    }
+    summary.detIdEnergy.back() += hits.energy[i];
+  }
+
+  // One hit energy histogram per (PDG, subdetector) present in the event, numbered in key order
+  histogramKeys_.resize(n);
+  for (std::size_t i = 0; i < n; ++i)
+    histogramKeys_[i] = histogramKey(hits.pdg[i], hits.subDetector[i]);
+  std::sort(histogramKeys_.begin(), histogramKeys_.end());
+  histogramKeys_.erase(std::unique(histogramKeys_.begin(), histogramKeys_.end()), histogramKeys_.end());
+  histogramCounts_.assign(histogramKeys_.size() * config_.energyBins, 0);
+
+  for (std::size_t i = 0; i < n; ++i) {
+    const float energy = hits.energy[i];
+
+    // Hit energy histogram of this (PDG, subdetector)
+    const std::uint64_t key = histogramKey(hits.pdg[i], hits.subDetector[i]);
+    const std::size_t histogram = std::lower_bound(histogramKeys_.begin(), histogramKeys_.end(), key) - histogramKeys_.begin();
+    ++histogramCounts_[histogram * config_.energyBins + energyBin(energy)];
+
+    // Eta-phi grid of the subdetector, hits on the beam line or outside the eta range are left out
+    if (!(hits.r[i] > 0.f))
+      continue;
+    const float etaPosition = (std::asinh(hits.z[i] / hits.r[i]) - config_.etaMin) * binsPerEta_;
+    if (!(etaPosition >= 0.f && etaPosition < static_cast<float>(config_.etaBins)))
+      continue;
+    const int etaBin = std::min(static_cast<int>(etaPosition), static_cast<int>(config_.etaBins) - 1);
+    const float phi = std::atan2(hits.y[i], hits.x[i]);
+    const int phiBin = std::min(static_cast<int>((phi + static_cast<float>(M_PI)) * binsPerPhi_), static_cast<int>(config_.phiBins) - 1);
+    const std::uint8_t subDetector = hits.subDetector[i];
+    grid_[(subDetector * config_.etaBins + etaBin) * config_.phiBins + phiBin] += energy;
+    gridSubDetectors_ |= 1u << subDetector;
+  }
+
+  // Emit the non-empty bins
+  const float logEnergyBinWidth = 1.f / binsPerLogEnergy_;
+  for (std::size_t h = 0; h < histogramKeys_.size(); ++h) {
+    for (unsigned int bin = 0; bin < config_.energyBins; ++bin) {
+      const std::uint32_t count = histogramCounts_[h * config_.energyBins + bin];
+      if (count == 0)
+        continue;
+      summary.histogramPdg.push_back(static_cast<std::int32_t>(histogramKeys_[h] >> 8));
+      summary.histogramSubDetector.push_back(histogramKeys_[h] & 0xff);
+      summary.histogramEnergyLow.push_back(std::pow(10.f, logEnergyMin_ + bin * logEnergyBinWidth));
+      summary.histogramCount.push_back(count);
+    }
+  }
+
+  // The grids are cleared as they are read, so the next event starts from zero
+  for (unsigned int subDetector = 0; subDetector < kHitSubDetectors; ++subDetector) {
+    if (!(gridSubDetectors_ & 1u << subDetector))
+      continue;
+    float* grid = &grid_[subDetector * config_.etaBins * config_.phiBins];
+    for (unsigned int etaBin = 0; etaBin < config_.etaBins; ++etaBin) {
+      for (unsigned int phiBin = 0; phiBin < config_.phiBins; ++phiBin) {
+        float& energy = grid[etaBin * config_.phiBins + phiBin];
+        if (energy == 0.f)
+          continue;
+        summary.cellSubDetector.push_back(subDetector);
+        summary.cellEta.push_back(config_.etaMin + (etaBin + 0.5f) / binsPerEta_);
+        summary.cellPhi.push_back(-static_cast<float>(M_PI) + (phiBin + 0.5f) / binsPerPhi_);
+        summary.cellEnergy.push_back(energy);
+        energy = 0.f;
+      }
+    }
+  }
+  gridSubDetectors_ = 0;
+}
@@ -0,0 +1,138 @@
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitColumns.h"
+
+#include "DataFormats/EcalDetId/interface/EcalSubdetector.h"
+#include "DataFormats/MuonDetId/interface/MuonSubdetId.h"
+#include "DataFormats/SiPixelDetId/interface/PixelSubdetector.h"
+#include "DataFormats/SiStripDetId/interface/StripSubdetector.h"
+
+HitSubDetector hitSubDetector(DetId detId) {
+  const int subdetId = detId.subdetId();
+  switch (detId.det()) {
+    case DetId::Tracker:
+      if (subdetId == PixelSubdetector::PixelBarrel) return HitSubDetector::PixelBarrel;
+      if (subdetId == PixelSubdetector::PixelEndcap) return HitSubDetector::PixelEndcap;
+      if (subdetId == StripSubdetector::TIB) return HitSubDetector::TIB;
+      if (subdetId == StripSubdetector::TID) return HitSubDetector::TID;
+      if (subdetId == StripSubdetector::TOB) return HitSubDetector::TOB;
+      if (subdetId == StripSubdetector::TEC) return HitSubDetector::TEC;
+      break;
+    case DetId::Ecal:
+      if (subdetId == EcalBarrel) return HitSubDetector::EB;
+      if (subdetId == EcalEndcap) return HitSubDetector::EE;
+      if (subdetId == EcalPreshower) return HitSubDetector::ES;
+      break;
+    case DetId::Hcal:
+      return HitSubDetector::HCAL;
+    case DetId::Muon:
+      if (subdetId == MuonSubdetId::DT) return HitSubDetector::MuonDT;
+      if (subdetId == MuonSubdetId::CSC) return HitSubDetector::MuonCSC;
+      if (subdetId == MuonSubdetId::RPC) return HitSubDetector::MuonRPC;
+      if (subdetId == MuonSubdetId::GEM) return HitSubDetector::MuonGEM;
+      break;
+    default:
+      break;
+  }
+  return HitSubDetector::Unknown;
+}
+
+const char* hitSubDetectorName(HitSubDetector subDetector) {
+  // Same names as the 'Detector Type' column used by RhadronAnalysis.py
+  switch (subDetector) {
+    case HitSubDetector::PixelBarrel: return "PixelBarrel";
+    case HitSubDetector::PixelEndcap: return "PixelEndcap";
+    case HitSubDetector::TIB: return "TIB";
+    case HitSubDetector::TID: return "TID";
+    case HitSubDetector::TOB: return "TOB";
+    case HitSubDetector::TEC: return "TEC";
+    case HitSubDetector::EB: return "EB";
+    case HitSubDetector::EE: return "EE";
+    case HitSubDetector::ES: return "ES";
+    case HitSubDetector::HCAL: return "HCAL";
+    case HitSubDetector::MuonDT: return "MuonDT";
+    case HitSubDetector::MuonCSC: return "MuonCSC";
+    case HitSubDetector::MuonRPC: return "MuonRPC";
+    case HitSubDetector::MuonGEM: return "MuonGEM";
+    case HitSubDetector::Unknown: break;
+  }
+  return "Unknown";
+}
+
+void HitColumns::push_back(const HitRow& row) {
+  energy.push_back(row.energy);
+  x.push_back(row.x);
+  y.push_back(row.y);
+  z.push_back(row.z);
+  r.push_back(row.r);
+  pdg.push_back(row.pdg);
+  trackEnergy.push_back(row.trackEnergy);
+  px.push_back(row.px);
+  py.push_back(row.py);
+  pz.push_back(row.pz);
+  subDetector.push_back(static_cast<std::uint8_t>(row.subDetector));
+  detId.push_back(row.detId);
+  parentPdg.push_back(row.parentPdg);
+  rHadron.push_back(row.rHadron);
+}
+
+void HitColumns::reserve(std::size_t n) {
+  energy.reserve(n);
+  x.reserve(n);
+  y.reserve(n);
+  z.reserve(n);
+  r.reserve(n);
+  pdg.reserve(n);
+  trackEnergy.reserve(n);
+  px.reserve(n);
+  py.reserve(n);
+  pz.reserve(n);
+  subDetector.reserve(n);
+  detId.reserve(n);
+  parentPdg.reserve(n);
+  rHadron.reserve(n);
+}
+
+void HitColumns::clear() {
+  energy.clear();
+  x.clear();
+  y.clear();
+  z.clear();
+  r.clear();
+  pdg.clear();
+  trackEnergy.clear();
+  px.clear();
+  py.clear();
+  pz.clear();
+  subDetector.clear();
+  detId.clear();
+  parentPdg.clear();
+  rHadron.clear();
+}
+
+namespace {
+  template <typename T>
+  void selectColumn(std::vector<T>& column, const std::vector<std::uint8_t>& keep) {
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < column.size(); ++i) {
+      column[kept] = column[i];
+      kept += keep[i] != 0;
+    }
+    column.resize(kept);
+  }
+}
+
+void HitColumns::select(const std::vector<std::uint8_t>& keep) {
+  selectColumn(energy, keep);
+  selectColumn(x, keep);
+  selectColumn(y, keep);
+  selectColumn(z, keep);
+  selectColumn(r, keep);
+  selectColumn(pdg, keep);
+  selectColumn(trackEnergy, keep);
+  selectColumn(px, keep);
+  selectColumn(py, keep);
+  selectColumn(pz, keep);
+  selectColumn(subDetector, keep);
+  selectColumn(detId, keep);
+  selectColumn(parentPdg, keep);
+  selectColumn(rHadron, keep);
+}
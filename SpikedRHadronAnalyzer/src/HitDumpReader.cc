@@ -0,0 +1,179 @@
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitDumpReader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "FWCore/Utilities/interface/Exception.h"
+
+namespace {
+  // Longest field written to the CSV, with room for the terminating NUL
+  constexpr std::size_t kFieldSize = 64;
+
+  // Copies the field at pos, which must end with separator, and moves pos past the separator.
+  // The mapped file is not NUL-terminated, so the strto* functions only ever read the copy.
+  bool nextField(const char*& pos, const char* end, char separator, char (&field)[kFieldSize]) {
+    const char* last = static_cast<const char*>(std::memchr(pos, separator, end - pos));
+    if (last == nullptr || last == pos || static_cast<std::size_t>(last - pos) >= kFieldSize)
+      return false;
+    std::memcpy(field, pos, last - pos);
+    field[last - pos] = '\0';
+    pos = last + 1;
+    return true;
+  }
+
+  bool parseField(const char*& pos, const char* end, float& value, char separator = ',') {
+    char field[kFieldSize];
+    if (!nextField(pos, end, separator, field))
+      return false;
+    // Out of range values come back as infinity or a denormal, as the writer printed them
+    char* last;
+    value = std::strtof(field, &last);
+    return *last == '\0';
+  }
+
+  bool parseField(const char*& pos, const char* end, std::int32_t& value, char separator = ',') {
+    char field[kFieldSize];
+    if (!nextField(pos, end, separator, field))
+      return false;
+    char* last;
+    errno = 0;
+    const long parsed = std::strtol(field, &last, 10);
+    if (*last != '\0' || errno == ERANGE || parsed < std::numeric_limits<std::int32_t>::min() ||
+        parsed > std::numeric_limits<std::int32_t>::max())
+      return false;
+    value = static_cast<std::int32_t>(parsed);
+    return true;
+  }
+
+  bool parseField(const char*& pos, const char* end, std::uint64_t& value, char separator = ',') {
+    char field[kFieldSize];
+    // strtoull would accept a sign and wrap negative numbers around
+    if (!nextField(pos, end, separator, field) || field[0] < '0' || field[0] > '9')
+      return false;
+    char* last;
+    errno = 0;
+    const unsigned long long parsed = std::strtoull(field, &last, 10);
+    if (*last != '\0' || errno == ERANGE)
+      return false;
+    value = parsed;
+    return true;
+  }
+}
+
+HitDumpReader::Mapping HitDumpReader::map(const std::string& fileName) {
+  const int fd = ::open(fileName.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw cms::Exception("FileOpenError") << "Unable to open " << fileName;
+  struct stat status;
+  if (::fstat(fd, &status) != 0) {
+    ::close(fd);
+    throw cms::Exception("FileReadError") << "Unable to stat " << fileName;
+  }
+
+  Mapping mapping;
+  mapping.size = static_cast<std::size_t>(status.st_size);
+  if (mapping.size > 0) {
+    void* data = ::mmap(nullptr, mapping.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      ::close(fd);
+      throw cms::Exception("FileReadError") << "Unable to map " << fileName;
+    }
+    mapping.data = static_cast<const char*>(data);
+  }
+  // The mapping stays valid after the descriptor is closed
+  ::close(fd);
+  return mapping;
+}
+
+void HitDumpReader::unmap(Mapping& mapping) {
+  if (mapping.data != nullptr)
+    ::munmap(const_cast<char*>(mapping.data), mapping.size);
+  mapping = Mapping();
+}
+
+HitDumpReader::HitDumpReader(const std::string& fileName) : fileName_(fileName) {
+  const std::string indexName = hitIndexFileName(fileName);
+  index_ = map(indexName);
+  try {
+    data_ = map(fileName);
+
+    HitIndexHeader header;
+    if (index_.size < sizeof(header))
+      throw cms::Exception("FileReadError") << indexName << " is not a hit index";
+    std::memcpy(&header, index_.data, sizeof(header));
+    if (std::memcmp(header.magic, kHitIndexMagic, sizeof(header.magic)) != 0 || header.entrySize != sizeof(HitIndexEntry))
+      throw cms::Exception("FileReadError") << indexName << " is not a hit index of this version";
+    if (header.format != static_cast<std::uint32_t>(HitIndexFormat::Csv))
+      throw cms::Exception("Configuration") << fileName << " is not a CSV hit dump, read ROOT dumps with the entry ranges of the index";
+    if (index_.size != sizeof(header) + header.events * sizeof(HitIndexEntry))
+      throw cms::Exception("FileReadError") << indexName << " is truncated";
+    if (header.dataSize != data_.size)
+      throw cms::Exception("FileReadError") << indexName << " does not match " << fileName << ", the file was changed after it was indexed";
+
+    // The header is 32 bytes, so the entries of a page-aligned mapping are aligned
+    entries_ = reinterpret_cast<const HitIndexEntry*>(index_.data + sizeof(header));
+    events_ = header.events;
+    for (std::size_t i = 0; i < events_; ++i) {
+      if (entries_[i].offset + entries_[i].bytes > data_.size)
+        throw cms::Exception("FileReadError") << indexName << " points past the end of " << fileName;
+    }
+  } catch (...) {
+    unmap(data_);
+    unmap(index_);
+    throw;
+  }
+}
+
+HitDumpReader::~HitDumpReader() {
+  unmap(data_);
+  unmap(index_);
+}
+
+const HitIndexEntry* HitDumpReader::find(std::uint64_t event) const {
+  const HitIndexEntry* end = entries_ + events_;
+  const HitIndexEntry* entry =
+      std::lower_bound(entries_, end, event, [](const HitIndexEntry& e, std::uint64_t value) { return e.event < value; });
+  return entry != end && entry->event == event ? entry : nullptr;
+}
+
+std::string_view HitDumpReader::rows(std::uint64_t event) const {
+  const HitIndexEntry* entry = find(event);
+  if (entry == nullptr)
+    return std::string_view();
+  return std::string_view(data_.data + entry->offset, entry->bytes);
+}
+
+bool HitDumpReader::hits(std::uint64_t event, HitColumns& hits) const {
+  hits.clear();
+  const HitIndexEntry* entry = find(event);
+  if (entry == nullptr)
+    return false;
+  hits.reserve(entry->rows);
+
+  const char* pos = data_.data + entry->offset;
+  const char* end = pos + entry->bytes;
+  while (pos < end) {
+    std::uint64_t rowEvent;
+    HitRow row{};
+    std::uint64_t rHadron;
+    const bool parsed = parseField(pos, end, rowEvent) && parseField(pos, end, row.energy) && parseField(pos, end, row.x) &&
+                        parseField(pos, end, row.y) && parseField(pos, end, row.z) && parseField(pos, end, row.r) &&
+                        parseField(pos, end, row.pdg) && parseField(pos, end, row.trackEnergy) &&
+                        parseField(pos, end, row.px) && parseField(pos, end, row.py) && parseField(pos, end, row.pz) &&
+                        parseField(pos, end, row.parentPdg) && parseField(pos, end, rHadron, '\n');
+    if (!parsed || rowEvent != event)
+      throw cms::Exception("FileReadError") << "Malformed row of event " << event << " in " << fileName_;
+    row.subDetector = HitSubDetector::Unknown;
+    row.rHadron = static_cast<std::uint8_t>(rHadron);
+    hits.push_back(row);
+  }
+  return true;
+}
@@ -0,0 +1,65 @@
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitIndex.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "FWCore/Utilities/interface/Exception.h"
+
+bool hitIndexDetector(HitSubDetector subDetector, HitIndexDetector& group) {
+  switch (subDetector) {
+    case HitSubDetector::PixelBarrel:
+    case HitSubDetector::PixelEndcap:
+    case HitSubDetector::TIB:
+    case HitSubDetector::TID:
+    case HitSubDetector::TOB:
+    case HitSubDetector::TEC:
+      group = HitIndexDetector::Tracker;
+      return true;
+    case HitSubDetector::EB:
+    case HitSubDetector::EE:
+    case HitSubDetector::ES:
+      group = HitIndexDetector::Ecal;
+      return true;
+    case HitSubDetector::HCAL:
+      group = HitIndexDetector::Hcal;
+      return true;
+    case HitSubDetector::MuonDT:
+    case HitSubDetector::MuonCSC:
+    case HitSubDetector::MuonRPC:
+    case HitSubDetector::MuonGEM:
+      group = HitIndexDetector::Muon;
+      return true;
+    case HitSubDetector::Unknown:
+      break;
+  }
+  return false;
+}
+
+std::string hitIndexFileName(const std::string& dataFileName) { return dataFileName + ".idx"; }
+
+void writeHitIndex(const std::string& dataFileName,
+                   HitIndexFormat format,
+                   std::uint64_t dataSize,
+                   const std::vector<HitIndexEntry>& entries) {
+  HitIndexHeader header;
+  std::memcpy(header.magic, kHitIndexMagic, sizeof(header.magic));
+  header.entrySize = sizeof(HitIndexEntry);
+  header.format = static_cast<std::uint32_t>(format);
+  header.events = entries.size();
+  header.dataSize = dataSize;
+
+  // Written under a temporary name, a reader never sees a partial index
+  const std::string fileName = hitIndexFileName(dataFileName);
+  const std::string partName = fileName + ".part";
+  std::FILE* file = std::fopen(partName.c_str(), "wb");
+  if (file == nullptr)
+    throw cms::Exception("FileWriteError") << "Unable to open the index file " << partName;
+  bool written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+  if (written && !entries.empty())
+    written = std::fwrite(entries.data(), sizeof(HitIndexEntry), entries.size(), file) == entries.size();
+  written = std::fclose(file) == 0 && written;
+  if (!written || std::rename(partName.c_str(), fileName.c_str()) != 0) {
+    std::remove(partName.c_str());
+    throw cms::Exception("FileWriteError") << "Unable to write the index file " << fileName;
+  }
+}
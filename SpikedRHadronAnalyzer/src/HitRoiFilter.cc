@@ -0,0 +1,74 @@
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitRoiFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "FWCore/Utilities/interface/Exception.h"
+
+namespace {
+  // Stands in for a missing R-hadron, far enough that no hit is within any cone of it
+  constexpr float kNoDirectionEta = 1e6f;
+}
+
+HitRoiFilter::HitRoiFilter(const Config& config) : config_(config) {
+  for (const float cone : config_.cone) {
+    if (!(cone >= 0.f))
+      throw cms::Exception("Configuration") << "HitRoiFilter: cone sizes must not be negative";
+  }
+  if (!(config_.energyThreshold >= 0.f))
+    throw cms::Exception("Configuration") << "HitRoiFilter: energy threshold must not be negative";
+  threshold_ = config_.energyThreshold > 0.f ? config_.energyThreshold : std::numeric_limits<float>::infinity();
+
+  coneSquared_.fill(0.f);
+  for (std::size_t i = 0; i < coneSquared_.size(); ++i) {
+    HitIndexDetector group;
+    if (hitIndexDetector(static_cast<HitSubDetector>(i), group)) {
+      const float cone = config_.cone[static_cast<std::size_t>(group)];
+      coneSquared_[i] = cone * cone;
+    }
+  }
+}
+
+std::size_t HitRoiFilter::prune(HitColumns& hits, const Direction* directions, std::size_t nDirections) {
+  const std::size_t n = hits.size();
+  if (n == 0)
+    return 0;
+
+  const Direction none{kNoDirectionEta, 0.f};
+  const Direction first = nDirections > 0 ? directions[0] : none;
+  const Direction second = nDirections > 1 ? directions[1] : none;
+
+  // Directions and cone of every hit. A hit on the beam line gets an infinite eta and is only kept by its energy.
+  eta_.resize(n);
+  phi_.resize(n);
+  coneSquaredOfHit_.resize(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    eta_[i] = std::asinh(hits.z[i] / hits.r[i]);
+    phi_[i] = std::atan2(hits.y[i], hits.x[i]);
+    coneSquaredOfHit_[i] = coneSquared_[hits.subDetector[i] & 15];
+  }
+
+  // Delta R to both directions, without branches. |phi difference| is at most 2 pi, so one fold wraps it.
+  const float twoPi = 2.f * static_cast<float>(M_PI);
+  const float* eta = eta_.data();
+  const float* phi = phi_.data();
+  const float* coneSquared = coneSquaredOfHit_.data();
+  const float* energy = hits.energy.data();
+  keep_.resize(n);
+  std::uint8_t* keep = keep_.data();
+  for (std::size_t i = 0; i < n; ++i) {
+    const float dEta1 = eta[i] - first.eta;
+    const float dPhi1 = std::fabs(phi[i] - first.phi);
+    const float dPhiWrapped1 = std::min(dPhi1, twoPi - dPhi1);
+    const float dEta2 = eta[i] - second.eta;
+    const float dPhi2 = std::fabs(phi[i] - second.phi);
+    const float dPhiWrapped2 = std::min(dPhi2, twoPi - dPhi2);
+    const bool inCone = (dEta1 * dEta1 + dPhiWrapped1 * dPhiWrapped1 < coneSquared[i]) |
+                        (dEta2 * dEta2 + dPhiWrapped2 * dPhiWrapped2 < coneSquared[i]);
+    keep[i] = inCone | (energy[i] >= threshold_);
+  }
+
+  hits.select(keep_);
+  return n - hits.size();
+}
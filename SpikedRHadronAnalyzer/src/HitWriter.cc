@@ -0,0 +1,562 @@
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitWriter.h"
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitIndex.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <vector>
+
+#include "Compression.h"
+#include "TFile.h"
+#include "TTree.h"
+
+#include "FWCore/Utilities/interface/Exception.h"
+
+void EventRecord::clear() {
+  event = 0;
+  hits.clear();
+  summary.clear();
+  rHadronMomentum = {};
+  for (auto& block : text)
+    block.clear();
+}
+
+std::size_t EventRecord::bytes() const {
+  std::size_t total = 0;
+  for (const auto& block : text)
+    total += block.size();
+  if (total > 0)
+    return total;
+  const std::size_t hitBytes = 10 * sizeof(float) + 2 * sizeof(std::int32_t) + sizeof(std::uint32_t) + 2 * sizeof(std::uint8_t);
+  const std::size_t summaryBytes = summary.detId.size() * (sizeof(std::uint32_t) + sizeof(std::uint8_t) + sizeof(float)) +
+                                   summary.histogramPdg.size() * (sizeof(std::int32_t) + sizeof(std::uint8_t) + sizeof(float) + sizeof(std::uint32_t)) +
+                                   summary.cellEta.size() * (sizeof(std::uint8_t) + 3 * sizeof(float));
+  return hits.size() * hitBytes + summaryBytes;
+}
+
+namespace {
+  // Summary files are named after the hit output, e.g. display.csv gives display_detIds.csv
+  std::string summaryFileName(const std::string& fileName, const std::string& suffix) {
+    const auto dot = fileName.rfind('.');
+    const auto slash = fileName.rfind('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+      return fileName + suffix;
+    return fileName.substr(0, dot) + suffix + fileName.substr(dot);
+  }
+
+  // Text formatting without streams or locales. Integers are converted by hand, floats use "%g",
+  // which is what std::ostream prints with its default precision, so the CSV content is unchanged.
+  void appendUnsigned(std::string& out, std::uint64_t value) {
+    char buffer[20];
+    char* last = buffer + sizeof(buffer);
+    char* first = last;
+    do {
+      *--first = static_cast<char>('0' + value % 10);
+      value /= 10;
+    } while (value != 0);
+    out.append(first, last);
+  }
+
+  void appendSigned(std::string& out, std::int64_t value) {
+    if (value < 0) {
+      out.push_back('-');
+      appendUnsigned(out, static_cast<std::uint64_t>(-(value + 1)) + 1);
+    } else {
+      appendUnsigned(out, static_cast<std::uint64_t>(value));
+    }
+  }
+
+  void appendFloat(std::string& out, float value) {
+    char buffer[32];
+    const int length = std::snprintf(buffer, sizeof(buffer), "%g", value);
+    out.append(buffer, length);
+  }
+
+  // Text file written through "<file>.part", restores the event-number order at close
+  class OrderedTextFile {
+  public:
+    OrderedTextFile(const std::string& fileName, const std::string& header)
+        : fileName_(fileName), partName_(fileName + ".part"), header_(header), file_(std::fopen(partName_.c_str(), "wb")) {
+      if (file_ == nullptr)
+        throw cms::Exception("Configuration") << "Unable to open the output file " << partName_;
+      put(file_, header_.data(), header_.size());
+      offset_ = header_.size();
+    }
+
+    ~OrderedTextFile() {
+      if (file_ != nullptr)
+        std::fclose(file_);
+    }
+
+    std::size_t headerSize() const { return header_.size(); }
+
+    void append(std::uint64_t event, const std::string& block) {
+      if (!blocks_.empty() && event < blocks_.back().event)
+        sorted_ = false;
+      blocks_.push_back({event, offset_, block.size()});
+      put(file_, block.data(), block.size());
+      offset_ += block.size();
+    }
+
+    void close() {
+      if (file_ == nullptr)
+        return;
+      const bool flushed = std::fclose(file_) == 0;
+      file_ = nullptr;
+      if (!flushed)
+        throw cms::Exception("FileWriteError") << "Unable to write " << partName_;
+
+      // Single-stream jobs always see the events in order, the file only needs its final name
+      if (sorted_) {
+        if (std::rename(partName_.c_str(), fileName_.c_str()) != 0)
+          throw cms::Exception("FileWriteError") << "Unable to rename " << partName_ << " to " << fileName_;
+        return;
+      }
+
+      std::stable_sort(blocks_.begin(), blocks_.end(), [](const Block& a, const Block& b) { return a.event < b.event; });
+      std::FILE* in = std::fopen(partName_.c_str(), "rb");
+      std::FILE* out = std::fopen(fileName_.c_str(), "wb");
+      if (in == nullptr || out == nullptr) {
+        if (in != nullptr)
+          std::fclose(in);
+        if (out != nullptr)
+          std::fclose(out);
+        throw cms::Exception("FileWriteError") << "Unable to reorder " << partName_ << " into " << fileName_;
+      }
+      put(out, header_.data(), header_.size());
+      std::vector<char> buffer;
+      for (const auto& block : blocks_) {
+        buffer.resize(block.size);
+        if (block.size != 0 && (std::fseek(in, static_cast<long>(block.offset), SEEK_SET) != 0 ||
+                                std::fread(buffer.data(), 1, block.size, in) != block.size)) {
+          std::fclose(in);
+          std::fclose(out);
+          throw cms::Exception("FileReadError") << "Unable to read back " << partName_;
+        }
+        put(out, buffer.data(), block.size);
+      }
+      std::fclose(in);
+      if (std::fclose(out) != 0)
+        throw cms::Exception("FileWriteError") << "Unable to write " << fileName_;
+      std::remove(partName_.c_str());
+    }
+
+  private:
+    struct Block {
+      std::uint64_t event;
+      std::size_t offset;
+      std::size_t size;
+    };
+
+    void put(std::FILE* file, const char* data, std::size_t size) {
+      if (size != 0 && std::fwrite(data, 1, size, file) != size)
+        throw cms::Exception("FileWriteError") << "Unable to write " << fileName_;
+    }
+
+    std::string fileName_;
+    std::string partName_;
+    std::string header_;
+    std::FILE* file_;
+    std::size_t offset_ = 0;
+    std::vector<Block> blocks_;
+    bool sorted_ = true;
+  };
+
+  // ROOT file written through "<file>.part", restores the event-number order of its trees at close
+  class OrderedRootFile {
+  public:
+    explicit OrderedRootFile(const std::string& fileName)
+        : fileName_(fileName), partName_(fileName + ".part"), file_(TFile::Open(partName_.c_str(), "RECREATE")) {
+      if (!file_ || file_->IsZombie())
+        throw cms::Exception("Configuration") << "Unable to open the output file " << partName_;
+
+      // LZ4 trades a slightly larger file for much faster writing and reading than the default
+      file_->SetCompressionSettings(ROOT::CompressionSettings(ROOT::kLZ4, 4));
+    }
+
+    // The tree is owned by the file
+    TTree* makeTree(const char* name, const char* title) {
+      TTree* tree = new TTree(name, title);
+      tree->SetDirectory(file_.get());
+      // Entries are flushed to disk in clusters of about this many bytes, which sets the read granularity
+      tree->SetAutoFlush(-kClusterBytes);
+      trees_.push_back({tree, {}});
+      return tree;
+    }
+
+    // Entries filled after this call belong to the event
+    void beginEvent(std::uint64_t event) {
+      if (!events_.empty() && event < events_.back())
+        sorted_ = false;
+      events_.push_back(event);
+      for (auto& tree : trees_)
+        tree.firstEntry.push_back(tree.tree->GetEntries());
+    }
+
+    void close() {
+      if (!file_)
+        return;
+
+      if (sorted_) {
+        file_->cd();
+        for (auto& tree : trees_)
+          tree.tree->Write();
+        file_->Close();
+        file_.reset();
+        if (std::rename(partName_.c_str(), fileName_.c_str()) != 0)
+          throw cms::Exception("FileWriteError") << "Unable to rename " << partName_ << " to " << fileName_;
+        return;
+      }
+
+      std::unique_ptr<TFile> output(TFile::Open(fileName_.c_str(), "RECREATE"));
+      if (!output || output->IsZombie())
+        throw cms::Exception("FileWriteError") << "Unable to open the output file " << fileName_;
+      output->SetCompressionSettings(ROOT::CompressionSettings(ROOT::kLZ4, 4));
+
+      std::vector<std::size_t> order(events_.size());
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b) { return events_[a] < events_[b]; });
+
+      // The clone shares the branch addresses, so each GetEntry fills the row the clone writes
+      for (auto& tree : trees_) {
+        TTree* sorted = tree.tree->CloneTree(0);
+        sorted->SetDirectory(output.get());
+        sorted->SetAutoFlush(-kClusterBytes);
+        const Long64_t nEntries = tree.tree->GetEntries();
+        for (const std::size_t i : order) {
+          const Long64_t last = i + 1 < order.size() ? tree.firstEntry[i + 1] : nEntries;
+          for (Long64_t entry = tree.firstEntry[i]; entry < last; ++entry) {
+            tree.tree->GetEntry(entry);
+            sorted->Fill();
+          }
+        }
+        output->cd();
+        sorted->Write();
+      }
+      output->Close();
+      file_->Close();
+      file_.reset();
+      std::remove(partName_.c_str());
+    }
+
+  private:
+    static constexpr Long64_t kClusterBytes = 32 * 1024 * 1024;
+
+    struct Tree {
+      TTree* tree;
+      std::vector<Long64_t> firstEntry;  // per event, in arrival order
+    };
+
+    std::string fileName_;
+    std::string partName_;
+    std::unique_ptr<TFile> file_;
+    std::vector<Tree> trees_;
+    std::vector<std::uint64_t> events_;
+    bool sorted_ = true;
+  };
+
+  // Index entries of a hit file, collected in arrival order. The offsets are assigned at close, in the
+  // event-number order that OrderedTextFile and OrderedRootFile restore with the same stable sort.
+  class EventIndex {
+  public:
+    EventIndex(const std::string& fileName, HitIndexFormat format, std::uint64_t firstOffset)
+        : fileName_(fileName), format_(format), firstOffset_(firstOffset) {}
+
+    void add(const EventRecord& record, std::uint64_t bytes) {
+      const HitColumns& hits = record.hits;
+      std::array<double, kHitIndexDetectors> energy{};
+      for (std::size_t i = 0; i < hits.size(); ++i) {
+        HitIndexDetector group;
+        if (hitIndexDetector(static_cast<HitSubDetector>(hits.subDetector[i]), group))
+          energy[static_cast<std::size_t>(group)] += hits.energy[i];
+      }
+
+      HitIndexEntry entry{};
+      entry.event = record.event;
+      entry.bytes = bytes;
+      entry.rows = hits.size();
+      for (std::size_t i = 0; i < kHitIndexDetectors; ++i)
+        entry.energy[i] = static_cast<float>(energy[i]);
+      entry.rHadronMomentum = record.rHadronMomentum;
+      entries_.push_back(entry);
+    }
+
+    void write() {
+      std::stable_sort(entries_.begin(), entries_.end(), [](const HitIndexEntry& a, const HitIndexEntry& b) { return a.event < b.event; });
+      std::uint64_t offset = firstOffset_;
+      for (auto& entry : entries_) {
+        entry.offset = offset;
+        offset += format_ == HitIndexFormat::Csv ? entry.bytes : entry.rows;
+      }
+      writeHitIndex(fileName_, format_, offset, entries_);
+    }
+
+  private:
+    std::string fileName_;
+    HitIndexFormat format_;
+    std::uint64_t firstOffset_;
+    std::vector<HitIndexEntry> entries_;
+  };
+
+  class CsvHitWriter : public HitWriter {
+  public:
+    explicit CsvHitWriter(const std::string& fileName)
+        : csv_(fileName, "Event,Energy Deposit,x [cm],y [cm],z [cm],r [cm],PDG,Track Energy,px,py,pz,Parent PDG,R-hadron\n"),
+          index_(fileName, HitIndexFormat::Csv, csv_.headerSize()) {}
+
+    void serialize(EventRecord& record) const override {
+      const HitColumns& hits = record.hits;
+      std::string& rows = record.text[0];
+      for (std::size_t i = 0; i < hits.size(); ++i) {
+        appendUnsigned(rows, record.event);
+        rows.push_back(',');
+        appendFloat(rows, hits.energy[i]);
+        rows.push_back(',');
+        appendFloat(rows, hits.x[i]);
+        rows.push_back(',');
+        appendFloat(rows, hits.y[i]);
+        rows.push_back(',');
+        appendFloat(rows, hits.z[i]);
+        rows.push_back(',');
+        appendFloat(rows, hits.r[i]);
+        rows.push_back(',');
+        appendSigned(rows, hits.pdg[i]);
+        rows.push_back(',');
+        appendFloat(rows, hits.trackEnergy[i]);
+        rows.push_back(',');
+        appendFloat(rows, hits.px[i]);
+        rows.push_back(',');
+        appendFloat(rows, hits.py[i]);
+        rows.push_back(',');
+        appendFloat(rows, hits.pz[i]);
+        rows.push_back(',');
+        appendSigned(rows, hits.parentPdg[i]);
+        rows.push_back(',');
+        appendUnsigned(rows, hits.rHadron[i]);
+        rows.push_back('\n');
+      }
+    }
+
+    void write(const EventRecord& record) override {
+      csv_.append(record.event, record.text[0]);
+      index_.add(record, record.text[0].size());
+    }
+
+    void close() override {
+      csv_.close();
+      index_.write();
+    }
+
+  private:
+    OrderedTextFile csv_;
+    EventIndex index_;
+  };
+
+  class RootHitWriter : public HitWriter {
+  public:
+    explicit RootHitWriter(const std::string& fileName) : output_(fileName), index_(fileName, HitIndexFormat::Root, 0) {
+      tree_ = output_.makeTree("hits", "SpikedRHadronAnalyzer hits");
+      tree_->Branch("event", &event_, "event/i");
+      tree_->Branch("energy", &row_.energy, "energy/F");
+      tree_->Branch("x", &row_.x, "x/F");
+      tree_->Branch("y", &row_.y, "y/F");
+      tree_->Branch("z", &row_.z, "z/F");
+      tree_->Branch("r", &row_.r, "r/F");
+      tree_->Branch("pdg", &row_.pdg, "pdg/I");
+      tree_->Branch("trackEnergy", &row_.trackEnergy, "trackEnergy/F");
+      tree_->Branch("px", &row_.px, "px/F");
+      tree_->Branch("py", &row_.py, "py/F");
+      tree_->Branch("pz", &row_.pz, "pz/F");
+      tree_->Branch("subDetector", &subDetector_, "subDetector/b");
+      tree_->Branch("detId", &row_.detId, "detId/i");
+      tree_->Branch("parentPdg", &row_.parentPdg, "parentPdg/I");
+      tree_->Branch("rHadron", &row_.rHadron, "rHadron/b");
+    }
+
+    void write(const EventRecord& record) override {
+      const HitColumns& hits = record.hits;
+      output_.beginEvent(record.event);
+      event_ = static_cast<UInt_t>(record.event);
+      for (std::size_t i = 0; i < hits.size(); ++i) {
+        row_.energy = hits.energy[i];
+        row_.x = hits.x[i];
+        row_.y = hits.y[i];
+        row_.z = hits.z[i];
+        row_.r = hits.r[i];
+        row_.pdg = hits.pdg[i];
+        row_.trackEnergy = hits.trackEnergy[i];
+        row_.px = hits.px[i];
+        row_.py = hits.py[i];
+        row_.pz = hits.pz[i];
+        subDetector_ = hits.subDetector[i];
+        row_.detId = hits.detId[i];
+        row_.parentPdg = hits.parentPdg[i];
+        row_.rHadron = hits.rHadron[i];
+        tree_->Fill();
+      }
+      index_.add(record, 0);
+    }
+
+    void close() override {
+      output_.close();
+      index_.write();
+    }
+
+  private:
+    OrderedRootFile output_;
+    EventIndex index_;
+    TTree* tree_ = nullptr;  // owned by the file of output_
+
+    UInt_t event_ = 0;
+    HitRow row_{};
+    UChar_t subDetector_ = 0;
+  };
+
+  class CsvSummaryWriter : public HitWriter {
+  public:
+    explicit CsvSummaryWriter(const std::string& fileName)
+        : detIds_(summaryFileName(fileName, "_detIds"), "Event,Detector Type,DetId,Energy Deposit\n"),
+          histograms_(summaryFileName(fileName, "_histograms"), "Event,PDG,Detector Type,Energy Bin Low Edge,Hits\n"),
+          etaPhi_(summaryFileName(fileName, "_etaPhi"), "Event,Detector Type,eta,phi,Energy Deposit\n") {}
+
+    void serialize(EventRecord& record) const override {
+      const EventSummary& summary = record.summary;
+      std::string& detIds = record.text[0];
+      for (std::size_t i = 0; i < summary.detId.size(); ++i) {
+        appendUnsigned(detIds, record.event);
+        detIds.push_back(',');
+        detIds.append(hitSubDetectorName(static_cast<HitSubDetector>(summary.detIdSubDetector[i])));
+        detIds.push_back(',');
+        appendUnsigned(detIds, summary.detId[i]);
+        detIds.push_back(',');
+        appendFloat(detIds, summary.detIdEnergy[i]);
+        detIds.push_back('\n');
+      }
+      std::string& histograms = record.text[1];
+      for (std::size_t i = 0; i < summary.histogramPdg.size(); ++i) {
+        appendUnsigned(histograms, record.event);
+        histograms.push_back(',');
+        appendSigned(histograms, summary.histogramPdg[i]);
+        histograms.push_back(',');
+        histograms.append(hitSubDetectorName(static_cast<HitSubDetector>(summary.histogramSubDetector[i])));
+        histograms.push_back(',');
+        appendFloat(histograms, summary.histogramEnergyLow[i]);
+        histograms.push_back(',');
+        appendUnsigned(histograms, summary.histogramCount[i]);
+        histograms.push_back('\n');
+      }
+      std::string& etaPhi = record.text[2];
+      for (std::size_t i = 0; i < summary.cellEnergy.size(); ++i) {
+        appendUnsigned(etaPhi, record.event);
+        etaPhi.push_back(',');
+        etaPhi.append(hitSubDetectorName(static_cast<HitSubDetector>(summary.cellSubDetector[i])));
+        etaPhi.push_back(',');
+        appendFloat(etaPhi, summary.cellEta[i]);
+        etaPhi.push_back(',');
+        appendFloat(etaPhi, summary.cellPhi[i]);
+        etaPhi.push_back(',');
+        appendFloat(etaPhi, summary.cellEnergy[i]);
+        etaPhi.push_back('\n');
+      }
+    }
+
+    void write(const EventRecord& record) override {
+      detIds_.append(record.event, record.text[0]);
+      histograms_.append(record.event, record.text[1]);
+      etaPhi_.append(record.event, record.text[2]);
+    }
+
+    void close() override {
+      detIds_.close();
+      histograms_.close();
+      etaPhi_.close();
+    }
+
+  private:
+    OrderedTextFile detIds_;
+    OrderedTextFile histograms_;
+    OrderedTextFile etaPhi_;
+  };
+
+  class RootSummaryWriter : public HitWriter {
+  public:
+    explicit RootSummaryWriter(const std::string& fileName) : output_(fileName) {
+      detIds_ = output_.makeTree("detIds", "SpikedRHadronAnalyzer summed energy per DetId");
+      detIds_->Branch("event", &event_, "event/i");
+      detIds_->Branch("subDetector", &subDetector_, "subDetector/b");
+      detIds_->Branch("detId", &detId_, "detId/i");
+      detIds_->Branch("energy", &energy_, "energy/F");
+
+      histograms_ = output_.makeTree("histograms", "SpikedRHadronAnalyzer hit energy histograms per PDG and subdetector");
+      histograms_->Branch("event", &event_, "event/i");
+      histograms_->Branch("pdg", &pdg_, "pdg/I");
+      histograms_->Branch("subDetector", &subDetector_, "subDetector/b");
+      histograms_->Branch("energyLow", &energyLow_, "energyLow/F");
+      histograms_->Branch("count", &count_, "count/i");
+
+      etaPhi_ = output_.makeTree("etaPhi", "SpikedRHadronAnalyzer eta-phi energy grid per subdetector");
+      etaPhi_->Branch("event", &event_, "event/i");
+      etaPhi_->Branch("subDetector", &subDetector_, "subDetector/b");
+      etaPhi_->Branch("eta", &eta_, "eta/F");
+      etaPhi_->Branch("phi", &phi_, "phi/F");
+      etaPhi_->Branch("energy", &energy_, "energy/F");
+    }
+
+    void write(const EventRecord& record) override {
+      const EventSummary& summary = record.summary;
+      output_.beginEvent(record.event);
+      event_ = static_cast<UInt_t>(record.event);
+      for (std::size_t i = 0; i < summary.detId.size(); ++i) {
+        subDetector_ = summary.detIdSubDetector[i];
+        detId_ = summary.detId[i];
+        energy_ = summary.detIdEnergy[i];
+        detIds_->Fill();
+      }
+      for (std::size_t i = 0; i < summary.histogramPdg.size(); ++i) {
+        pdg_ = summary.histogramPdg[i];
+        subDetector_ = summary.histogramSubDetector[i];
+        energyLow_ = summary.histogramEnergyLow[i];
+        count_ = summary.histogramCount[i];
+        histograms_->Fill();
+      }
+      for (std::size_t i = 0; i < summary.cellEnergy.size(); ++i) {
+        subDetector_ = summary.cellSubDetector[i];
+        eta_ = summary.cellEta[i];
+        phi_ = summary.cellPhi[i];
+        energy_ = summary.cellEnergy[i];
+        etaPhi_->Fill();
+      }
+    }
+
+    void close() override { output_.close(); }
+
+  private:
+    OrderedRootFile output_;
+    TTree* detIds_ = nullptr;  // owned by the file of output_
+    TTree* histograms_ = nullptr;
+    TTree* etaPhi_ = nullptr;
+
+    UInt_t event_ = 0;
+    UChar_t subDetector_ = 0;
+    UInt_t detId_ = 0;
+    Int_t pdg_ = 0;
+    Float_t energyLow_ = 0.f;
+    UInt_t count_ = 0;
+    Float_t eta_ = 0.f;
+    Float_t phi_ = 0.f;
+    Float_t energy_ = 0.f;
+  };
+}
+
+std::unique_ptr<HitWriter> HitWriter::create(const std::string& format, const std::string& fileName, const std::string& mode) {
+  if (mode != "hits" && mode != "summary")
+    throw cms::Exception("Configuration") << "Unknown outputMode '" << mode << "', expected 'hits' or 'summary'";
+  const bool summary = mode == "summary";
+  if (format == "csv")
+    return summary ? std::unique_ptr<HitWriter>(std::make_unique<CsvSummaryWriter>(fileName))
+                   : std::unique_ptr<HitWriter>(std::make_unique<CsvHitWriter>(fileName));
+  if (format == "root")
+    return summary ? std::unique_ptr<HitWriter>(std::make_unique<RootSummaryWriter>(fileName))
+                   : std::unique_ptr<HitWriter>(std::make_unique<RootHitWriter>(fileName));
+  throw cms::Exception("Configuration") << "Unknown outputFormat '" << format << "', expected 'csv' or 'root'";
+}
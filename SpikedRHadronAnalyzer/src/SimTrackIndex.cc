@@ -0,0 +1,59 @@
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/SimTrackIndex.h"
+
+#include <algorithm>
+
+namespace {
+  // Largest id range, relative to the number of tracks, that is still indexed with a flat vector
+  constexpr std::size_t kDenseFactor = 16;
+  constexpr std::size_t kDenseSlack = 4096;
+}
+
+void SimTrackIndex::build(const edm::SimTrackContainer& tracks) {
+  tracks_ = &tracks;
+
+  unsigned int maxId = 0;
+  for (const auto& track : tracks)
+    maxId = std::max(maxId, track.trackId());
+
+  dense_ = static_cast<std::size_t>(maxId) < kDenseFactor * tracks.size() + kDenseSlack;
+
+  if (dense_) {
+    slots_.assign(static_cast<std::size_t>(maxId) + 1, -1);
+    for (std::size_t i = 0; i < tracks.size(); ++i) {
+      // Keep the first occurrence, which is what a linear search would return
+      int& slot = slots_[tracks[i].trackId()];
+      if (slot < 0)
+        slot = static_cast<int>(i);
+    }
+    return;
+  }
+
+  // Power-of-two table kept at most half full
+  std::size_t capacity = 16;
+  while (capacity < 2 * tracks.size())
+    capacity <<= 1;
+  mask_ = capacity - 1;
+  slots_.assign(capacity, -1);
+  keys_.resize(capacity);
+
+  for (std::size_t i = 0; i < tracks.size(); ++i) {
+    const unsigned int trackId = tracks[i].trackId();
+    std::size_t bucket = hash(trackId) & mask_;
+    while (slots_[bucket] >= 0 && keys_[bucket] != trackId)
+      bucket = (bucket + 1) & mask_;
+    if (slots_[bucket] < 0) {
+      keys_[bucket] = trackId;
+      slots_[bucket] = static_cast<int>(i);
+    }
+  }
+}
+
+int SimTrackIndex::probe(unsigned int trackId) const {
+  std::size_t bucket = hash(trackId) & mask_;
+  while (slots_[bucket] >= 0) {
+    if (keys_[bucket] == trackId)
+      return slots_[bucket];
+    bucket = (bucket + 1) & mask_;
+  }
+  return -1;
+}
@@ -0,0 +1,67 @@
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/SimTruthGraph.h"
+
+void SimTruthGraph::build(const SimTrackIndex& trackIndex,
+                          const edm::SimTrackContainer& tracks,
+                          const edm::SimVertexContainer& vertices) {
+  trackIndex_ = &trackIndex;
+  const int nTracks = static_cast<int>(tracks.size());
+
+  // Parent of each track, through the vertex it starts from
+  parent_.assign(nTracks, -1);
+  parentPdg_.assign(nTracks, 0);
+  for (int i = 0; i < nTracks; ++i) {
+    const SimTrack& track = tracks[i];
+    if (track.noVertex() || track.vertIndex() >= static_cast<int>(vertices.size()))
+      continue;
+    const SimVertex& vertex = vertices[track.vertIndex()];
+    if (vertex.noParent())
+      continue;
+    const int parent = trackIndex.position(static_cast<unsigned int>(vertex.parentIndex()));
+    if (parent < 0 || parent == i)
+      continue;
+    parent_[i] = parent;
+    parentPdg_[i] = tracks[parent].type();
+  }
+
+  // Top-most R-hadron ancestor, resolved from the top of each walk down
+  topRHadron_.assign(nTracks, kUnresolved);
+  for (int i = 0; i < nTracks; ++i) {
+    path_.clear();
+    int node = i;
+    // A walk longer than the event can only come from a malformed cycle, which is cut there
+    while (node >= 0 && topRHadron_[node] == kUnresolved && static_cast<int>(path_.size()) <= nTracks) {
+      path_.push_back(node);
+      node = parent_[node];
+    }
+    int top = node >= 0 && topRHadron_[node] != kUnresolved ? topRHadron_[node] : -1;
+    for (auto step = path_.rbegin(); step != path_.rend(); ++step) {
+      if (top < 0 && isRHadron(tracks[*step].type()))
+        top = *step;
+      topRHadron_[*step] = top;
+    }
+  }
+
+  // Number the top-most R-hadrons by trackId
+  int first = -1;
+  int second = -1;
+  for (int i = 0; i < nTracks; ++i) {
+    if (topRHadron_[i] != i)
+      continue;
+    if (first < 0 || tracks[i].trackId() < tracks[first].trackId()) {
+      second = first;
+      first = i;
+    } else if (second < 0 || tracks[i].trackId() < tracks[second].trackId()) {
+      second = i;
+    }
+  }
+
+  rHadronPosition_ = {{first, second}};
+  rHadron_.assign(nTracks, 0);
+  for (int i = 0; i < nTracks; ++i) {
+    const int top = topRHadron_[i];
+    if (top >= 0 && top == first)
+      rHadron_[i] = 1;
+    else if (top >= 0 && top == second)
+      rHadron_[i] = 2;
+  }
+}
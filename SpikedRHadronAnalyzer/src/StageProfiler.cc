@@ -0,0 +1,142 @@
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/StageProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+
+const char* analyzerStageName(AnalyzerStage stage) {
+  switch (stage) {
+    case AnalyzerStage::Products: return "products";
+    case AnalyzerStage::Truth: return "truth";
+    case AnalyzerStage::Tracker: return "tracker";
+    case AnalyzerStage::Ecal: return "ecal";
+    case AnalyzerStage::Hcal: return "hcal";
+    case AnalyzerStage::Muon: return "muon";
+    case AnalyzerStage::Roi: return "roi";
+    case AnalyzerStage::Summary: return "summary";
+    case AnalyzerStage::Output: return "output";
+    case AnalyzerStage::Event: return "event";
+  }
+  return "unknown";
+}
+
+LogHistogram::LogHistogram(double min, double max)
+    : logMin_(std::log(min)), binsPerLog_(kBins / (std::log(max) - std::log(min))) {}
+
+void LogHistogram::fill(double value) {
+  const double position = value > 0. ? (std::log(value) - logMin_) * binsPerLog_ : 0.;
+  const std::size_t bin = position <= 0. ? 0 : std::min<std::size_t>(static_cast<std::size_t>(position), kBins - 1);
+  ++counts_[bin];
+  if (entries_ == 0) {
+    min_ = value;
+    max_ = value;
+  } else {
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+  ++entries_;
+  sum_ += value;
+}
+
+void LogHistogram::add(const LogHistogram& other) {
+  if (other.entries_ == 0)
+    return;
+  for (std::size_t i = 0; i < kBins; ++i)
+    counts_[i] += other.counts_[i];
+  min_ = entries_ > 0 ? std::min(min_, other.min_) : other.min_;
+  max_ = entries_ > 0 ? std::max(max_, other.max_) : other.max_;
+  entries_ += other.entries_;
+  sum_ += other.sum_;
+}
+
+double LogHistogram::quantile(double q) const {
+  if (entries_ == 0)
+    return 0.;
+  const double target = std::min(std::max(q, 0.), 1.) * entries_;
+  double below = 0.;
+  for (std::size_t i = 0; i < kBins; ++i) {
+    if (counts_[i] == 0 || below + counts_[i] < target) {
+      below += counts_[i];
+      continue;
+    }
+    // Entries are taken as spread evenly in log within the bin
+    const double fraction = (target - below) / counts_[i];
+    const double value = std::exp(logMin_ + (i + fraction) / binsPerLog_);
+    return std::min(std::max(value, min_), max_);
+  }
+  return max_;
+}
+
+void LogHistogram::writeJson(std::ostream& out, double scale) const {
+  out << "{\"entries\": " << entries_ << ", \"mean\": " << mean() * scale << ", \"min\": " << min() * scale
+      << ", \"p50\": " << quantile(0.5) * scale << ", \"p90\": " << quantile(0.9) * scale
+      << ", \"p99\": " << quantile(0.99) * scale << ", \"max\": " << max() * scale << "}";
+}
+
+StageProfiler::StageProfiler() = default;
+
+void StageProfiler::record(AnalyzerStage stage, Clock::duration elapsed, std::uint64_t hits, std::uint64_t dropped) {
+  Stage& entry = stages_[static_cast<std::size_t>(stage)];
+  const double seconds = std::chrono::duration<double>(elapsed).count();
+  ++entry.calls;
+  entry.seconds += seconds;
+  entry.hits += hits;
+  entry.dropped += dropped;
+  entry.latency.fill(seconds);
+}
+
+void StageProfiler::recordEvent(Clock::duration elapsed, std::uint64_t hits, std::uint64_t bytes) {
+  const double seconds = std::chrono::duration<double>(elapsed).count();
+  eventLatency_.fill(seconds);
+  if (seconds > 0.)
+    hitsPerSecond_.fill(hits / seconds);
+  bytesPerEvent_.fill(bytes);
+  hits_ += hits;
+  bytes_ += bytes;
+}
+
+void StageProfiler::add(const StageProfiler& other) {
+  for (std::size_t i = 0; i < kAnalyzerStages; ++i) {
+    stages_[i].calls += other.stages_[i].calls;
+    stages_[i].seconds += other.stages_[i].seconds;
+    stages_[i].hits += other.stages_[i].hits;
+    stages_[i].dropped += other.stages_[i].dropped;
+    stages_[i].latency.add(other.stages_[i].latency);
+  }
+  eventLatency_.add(other.eventLatency_);
+  hitsPerSecond_.add(other.hitsPerSecond_);
+  bytesPerEvent_.add(other.bytesPerEvent_);
+  hits_ += other.hits_;
+  bytes_ += other.bytes_;
+}
+
+void StageProfiler::writeJson(std::ostream& out, double wallSeconds, unsigned int streams) const {
+  const double eventSeconds = stages_[static_cast<std::size_t>(AnalyzerStage::Event)].seconds;
+  out << "{\n"
+      << "  \"events\": " << events() << ",\n"
+      << "  \"streams\": " << streams << ",\n"
+      << "  \"wallSeconds\": " << wallSeconds << ",\n"
+      << "  \"eventsPerSecond\": " << (wallSeconds > 0. ? events() / wallSeconds : 0.) << ",\n"
+      << "  \"hitsWritten\": " << hits_ << ",\n"
+      << "  \"bytesWritten\": " << bytes_ << ",\n"
+      << "  \"eventLatencyMilliseconds\": ";
+  eventLatency_.writeJson(out, 1e3);
+  out << ",\n  \"hitsPerSecond\": ";
+  hitsPerSecond_.writeJson(out);
+  out << ",\n  \"bytesPerEvent\": ";
+  bytesPerEvent_.writeJson(out);
+  out << ",\n  \"stages\": {";
+  // Fractions are of the time spent in analyze, summed over the streams
+  const char* separator = "\n";
+  for (std::size_t i = 0; i < kAnalyzerStages; ++i) {
+    const Stage& stage = stages_[i];
+    out << separator << "    \"" << analyzerStageName(static_cast<AnalyzerStage>(i)) << "\": {\"calls\": " << stage.calls
+        << ", \"seconds\": " << stage.seconds << ", \"fraction\": " << (eventSeconds > 0. ? stage.seconds / eventSeconds : 0.)
+        << ", \"hits\": " << stage.hits << ", \"droppedHits\": " << stage.dropped
+        << ", \"hitsPerSecond\": " << (stage.seconds > 0. ? stage.hits / stage.seconds : 0.) << ", \"latencyMicroseconds\": ";
+    stage.latency.writeJson(out, 1e6);
+    out << "}";
+    separator = ",\n";
+  }
+  out << "\n  }\n}\n";
+}
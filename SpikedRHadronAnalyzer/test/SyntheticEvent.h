@@ -0,0 +1,319 @@
+#ifndef RHadronProduction_SpikedRHadronAnalyzer_test_SyntheticEvent_h
+#define RHadronProduction_SpikedRHadronAnalyzer_test_SyntheticEvent_h
+
+// Synthetic g4SimHits products for running SpikedRHadronAnalyzer in a TestProcessor without GEN-SIM input.
+//
+// Two R-hadrons (trackIds 1 and 2) come from the primary vertex, every other track comes from a
+// vertex of one of them, alternating. Hits sit on DetIds of the 2018 geometry: BPix layer 1,
+// EB, HB depth 1 and the CSC ME2/2 layers. Hit k of an event deposits k MeV, so every written row
+// can be traced back to its hit as long as the event has less than a million hits (the CSV keeps
+// 6 digits). A fraction of the hits points to trackIds that are not in the event, the analyzer
+// must drop those. The gen particles hold the two R-hadrons, at fixed directions in the barrel.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "FWCore/TestProcessor/interface/TestProcessor.h"
+#include "DataFormats/DetId/interface/DetId.h"
+#include "DataFormats/HepMCCandidate/interface/GenParticle.h"
+#include "DataFormats/EcalDetId/interface/EBDetId.h"
+#include "DataFormats/HcalDetId/interface/HcalDetId.h"
+#include "DataFormats/MuonDetId/interface/CSCDetId.h"
+#include "DataFormats/SiPixelDetId/interface/PixelSubdetector.h"
+#include "SimDataFormats/CaloHit/interface/PCaloHitContainer.h"
+#include "SimDataFormats/Track/interface/SimTrackContainer.h"
+#include "SimDataFormats/TrackingHit/interface/PSimHitContainer.h"
+#include "SimDataFormats/Vertex/interface/SimVertexContainer.h"
+
+namespace synthetic {
+
+  // Instance labels of the g4SimHits collections read by the analyzer, as in SpikedRHadronAnalyzer_cfg.py
+  constexpr std::array<const char*, 12> kTrackerHitCollections = {{
+    "TrackerHitsTIBLowTof", "TrackerHitsTIBHighTof", "TrackerHitsTOBLowTof", "TrackerHitsTOBHighTof",
+    "TrackerHitsTIDLowTof", "TrackerHitsTIDHighTof", "TrackerHitsTECLowTof", "TrackerHitsTECHighTof",
+    "TrackerHitsPixelBarrelLowTof", "TrackerHitsPixelBarrelHighTof", "TrackerHitsPixelEndcapLowTof", "TrackerHitsPixelEndcapHighTof"
+  }};
+  constexpr std::array<const char*, 3> kEcalHitCollections = {{"EcalHitsEB", "EcalHitsEE", "EcalHitsES"}};
+  constexpr std::array<const char*, 4> kMuonHitCollections = {{"MuonDTHits", "MuonCSCHits", "MuonRPCHits", "MuonGEMHits"}};
+
+  // Collections the synthetic hits are put in
+  constexpr std::size_t kTrackerCollection = 8;  // TrackerHitsPixelBarrelLowTof
+  constexpr std::size_t kEcalCollection = 0;     // EcalHitsEB
+  constexpr std::size_t kMuonCollection = 1;     // MuonCSCHits
+
+  constexpr int kRHadronPdg = 1000993;
+  constexpr int kChildPdg = 211;
+
+  // Gen-level (eta, phi) of the two R-hadrons
+  constexpr std::array<std::array<double, 2>, 2> kRHadronDirections = {{{{0.3, 1.0}}, {{-0.3, -2.0}}}};
+
+  struct Config {
+    std::size_t tracks = 1000;
+    std::size_t trackerHits = 1000;
+    std::size_t ecalHits = 0;
+    std::size_t hcalHits = 0;
+    std::size_t muonHits = 0;
+    double unmatchedFraction = 0.;  // hits pointing to a trackId that is not in the event
+  };
+
+  // One row of the CSV hit dump as the analyzer should write it
+  struct ExpectedRow {
+    long energyMeV;  // energy deposit, rounded to MeV
+    int pdg;
+    float trackEnergy;
+    int parentPdg;
+    int rHadron;
+  };
+
+  struct Event {
+    reco::GenParticleCollection genParticles;
+    edm::SimTrackContainer tracks;
+    edm::SimVertexContainer vertices;
+    edm::PSimHitContainer trackerHits;
+    edm::PCaloHitContainer ecalHits;
+    edm::PCaloHitContainer hcalHits;
+    edm::PSimHitContainer muonHits;
+
+    std::size_t hits() const { return trackerHits.size() + ecalHits.size() + hcalHits.size() + muonHits.size(); }
+  };
+
+  // Phase-1 TrackerTopology layout of BPix layer 1: 12 ladders of 8 modules
+  inline std::uint32_t pixelBarrelId(std::size_t i) {
+    const std::uint32_t ladder = 1 + i % 12;
+    const std::uint32_t module = 1 + (i / 12) % 8;
+    return (static_cast<std::uint32_t>(DetId::Tracker) << 28) | (static_cast<std::uint32_t>(PixelSubdetector::PixelBarrel) << 25) |
+           (1u << 20) | (ladder << 12) | (module << 2);
+  }
+
+  inline std::uint32_t ecalBarrelId(std::size_t i) {
+    const int ieta = 1 + static_cast<int>(i % 85);
+    const int iphi = 1 + static_cast<int>((i / 85) % 360);
+    return EBDetId(i % 2 == 0 ? ieta : -ieta, iphi).rawId();
+  }
+
+  inline std::uint32_t hcalBarrelId(std::size_t i) {
+    const int ieta = 1 + static_cast<int>(i % 16);
+    const int iphi = 1 + static_cast<int>((i / 16) % 72);
+    return HcalDetId(HcalBarrel, i % 2 == 0 ? ieta : -ieta, iphi, 1).rawId();
+  }
+
+  inline std::uint32_t cscId(std::size_t i) {
+    return CSCDetId(1, 2, 2, 1 + static_cast<int>(i % 36), 1 + static_cast<int>((i / 36) % 6)).rawId();
+  }
+
+  inline Event makeEvent(const Config& config, std::mt19937& rng) {
+    Event event;
+
+    for (std::size_t i = 0; i < kRHadronDirections.size(); ++i) {
+      const reco::GenParticle::PolarLorentzVector p4(500., kRHadronDirections[i][0], kRHadronDirections[i][1], 1800.);
+      event.genParticles.emplace_back(0, p4, reco::GenParticle::Point(0., 0., 0.), i == 0 ? kRHadronPdg : -kRHadronPdg, 1, true);
+    }
+
+    // Primary vertex, then one vertex per R-hadron
+    event.vertices.emplace_back(math::XYZVectorD(0., 0., 0.), 0.f, -1, 0);
+    event.vertices.emplace_back(math::XYZVectorD(1., 0., 0.), 0.1f, 1, 1);
+    event.vertices.emplace_back(math::XYZVectorD(-1., 0., 0.), 0.1f, 2, 2);
+
+    // Geant4 only saves some of its tracks, so the ids after the R-hadrons have gaps
+    std::uniform_int_distribution<unsigned int> gap(1, 4);
+    const std::size_t nTracks = std::max<std::size_t>(config.tracks, 3);
+    event.tracks.reserve(nTracks);
+    unsigned int trackId = 0;
+    for (std::size_t i = 0; i < nTracks; ++i) {
+      trackId = i < 2 ? i + 1 : trackId + gap(rng);
+      const double e = 10. + static_cast<double>(i % 1000);
+      const int pdg = i == 0 ? kRHadronPdg : (i == 1 ? -kRHadronPdg : kChildPdg);
+      const int vertex = i < 2 ? 0 : 1 + static_cast<int>(i % 2);
+      SimTrack track(pdg, math::XYZTLorentzVectorD(0., 0., e / 2., e), vertex, -1);
+      track.setTrackId(trackId);
+      event.tracks.push_back(track);
+    }
+    const unsigned int missingId = trackId + 1;
+
+    std::uniform_int_distribution<std::size_t> pick(0, event.tracks.size() - 1);
+    std::bernoulli_distribution unmatched(config.unmatchedFraction);
+    std::size_t k = 0;
+    auto nextTrack = [&]() { return unmatched(rng) ? missingId : event.tracks[pick(rng)].trackId(); };
+    auto nextEnergy = [&]() { return static_cast<float>(++k) * 1e-3f; };
+
+    event.trackerHits.reserve(config.trackerHits);
+    for (std::size_t i = 0; i < config.trackerHits; ++i) {
+      const float energy = nextEnergy();
+      event.trackerHits.emplace_back(Local3DPoint(0.1f, 0.1f, -0.01f), Local3DPoint(0.1f, 0.1f, 0.01f), 1.f, 5.f, energy,
+                                     kChildPdg, pixelBarrelId(i), nextTrack(), 0.f, 0.f);
+    }
+    event.ecalHits.reserve(config.ecalHits);
+    for (std::size_t i = 0; i < config.ecalHits; ++i) {
+      const float energy = nextEnergy();
+      event.ecalHits.emplace_back(ecalBarrelId(i), energy, 5.f, static_cast<int>(nextTrack()));
+    }
+    event.hcalHits.reserve(config.hcalHits);
+    for (std::size_t i = 0; i < config.hcalHits; ++i) {
+      const float energy = nextEnergy();
+      event.hcalHits.emplace_back(hcalBarrelId(i), energy, 5.f, static_cast<int>(nextTrack()));
+    }
+    event.muonHits.reserve(config.muonHits);
+    for (std::size_t i = 0; i < config.muonHits; ++i) {
+      const float energy = nextEnergy();
+      event.muonHits.emplace_back(Local3DPoint(0.f, 0.f, -0.1f), Local3DPoint(0.f, 0.f, 0.1f), 1.f, 20.f, energy,
+                                  kChildPdg, cscId(i), nextTrack(), 0.f, 0.f);
+    }
+    return event;
+  }
+
+  // Rows of the CSV hit dump for this event, in the order the analyzer writes them
+  inline std::vector<ExpectedRow> expectedRows(const Event& event) {
+    std::vector<ExpectedRow> rows;
+    auto add = [&](float energy, unsigned int trackId) {
+      auto track = std::find_if(event.tracks.begin(), event.tracks.end(), [trackId](const SimTrack& t) { return t.trackId() == trackId; });
+      if (track == event.tracks.end())
+        return;
+      const std::size_t i = track - event.tracks.begin();
+      // The R-hadrons are primaries, even tracks come from the first one and odd tracks from the second
+      const int rHadron = i < 2 ? static_cast<int>(i) + 1 : 1 + static_cast<int>(i % 2);
+      const int parentPdg = i < 2 ? 0 : (rHadron == 1 ? kRHadronPdg : -kRHadronPdg);
+      rows.push_back({std::lround(energy * 1e3), track->type(), static_cast<float>(track->momentum().E()), parentPdg, rHadron});
+    };
+    for (const auto& hit : event.trackerHits)
+      add(hit.energyLoss(), hit.trackId());
+    for (const auto& hit : event.ecalHits)
+      add(hit.energy(), hit.geantTrackId());
+    for (const auto& hit : event.hcalHits)
+      add(hit.energy(), hit.geantTrackId());
+    for (const auto& hit : event.muonHits)
+      add(hit.energyLoss(), hit.trackId());
+    return rows;
+  }
+
+  // Quoted, comma-separated labels of all hit collections, for analyzerConfig
+  inline std::string labelList() {
+    std::string list;
+    auto add = [&list](const char* label) { list += (list.empty() ? "\"" : ", \"") + std::string(label) + "\""; };
+    for (const char* label : kTrackerHitCollections)
+      add(label);
+    for (const char* label : kEcalHitCollections)
+      add(label);
+    add("HcalHits");
+    for (const char* label : kMuonHitCollections)
+      add(label);
+    return list;
+  }
+
+  // TestProcessor configuration of the analyzer with the ideal 2018 geometry of the production (DB:Extended) and hardcoded HCAL conditions
+  inline std::string analyzerConfig(const std::string& outputFile,
+                                    const std::string& outputFormat = "csv",
+                                    const std::string& outputMode = "hits",
+                                    const std::string& profileFile = "",
+                                    bool roiMode = false,
+                                    double roiCone = 0.5,
+                                    double roiEnergyThreshold = 0.) {
+    return R"_(from FWCore.TestProcessor.TestProcess import *
+process = TestProcess()
+process.load("Configuration.Geometry.GeometryExtended2018Reco_cff")
+process.load("CalibCalorimetry.HcalPlugins.Hcal_FakeConditions_cff")
+process.trackerGeometry.applyAlignment = False
+process.DTGeometryESModule.applyAlignment = False
+process.CSCGeometryESModule.applyAlignment = False
+tags = {}
+for name in ["G4TrkSrc", "G4VtxSrc"]:
+    tags[name] = cms.InputTag("g4SimHits")
+for name in [)_" + labelList() + R"_(]:
+    tags[name] = cms.InputTag("g4SimHits", name)
+process.toTest = cms.EDAnalyzer("SpikedRHadronAnalyzer",
+    outputFileName = cms.string(")_" + outputFile + R"_("),
+    outputFormat = cms.string(")_" + outputFormat + R"_("),
+    outputMode = cms.string(")_" + outputMode + R"_("),
+    outputQueueSize = cms.uint32(64),
+    profileFile = cms.string(")_" + profileFile + R"_("),
+    summaryEtaBins = cms.uint32(50),
+    summaryEtaMin = cms.double(-5.),
+    summaryEtaMax = cms.double(5.),
+    summaryPhiBins = cms.uint32(72),
+    summaryEnergyBins = cms.uint32(50),
+    summaryEnergyMin = cms.double(1e-6),
+    summaryEnergyMax = cms.double(1e4),
+    roiMode = cms.bool()_" + (roiMode ? "True" : "False") + R"_(),
+    roiTrackerCone = cms.double()_" + std::to_string(roiCone) + R"_(),
+    roiEcalCone = cms.double()_" + std::to_string(roiCone) + R"_(),
+    roiHcalCone = cms.double()_" + std::to_string(roiCone) + R"_(),
+    roiMuonCone = cms.double()_" + std::to_string(roiCone) + R"_(),
+    roiEnergyThreshold = cms.double()_" + std::to_string(roiEnergyThreshold) + R"_(),
+    gen_info = cms.InputTag("genParticles"),
+    HcalTestNumbering = cms.bool(False),
+    **tags
+)
+process.moduleToTest(process.toTest)
+)_";
+  }
+
+  // (token, collection) pairs of an array of collections, as TestProcessor::test takes them
+  template <typename T, std::size_t N, std::size_t... I>
+  auto putPairs(const std::array<edm::EDPutTokenT<T>, N>& tokens,
+                std::array<std::unique_ptr<T>, N>& collections,
+                std::index_sequence<I...>) {
+    return std::make_tuple(std::make_pair(tokens[I], std::move(collections[I]))...);
+  }
+
+  // Declares the genParticles and g4SimHits products in a TestProcessor configuration and puts one synthetic event into them
+  class Products {
+  public:
+    explicit Products(edm::test::TestProcessor::Config& config)
+        : genParticles_(config.produces<reco::GenParticleCollection>("genParticles")),
+          tracks_(config.produces<edm::SimTrackContainer>("g4SimHits")),
+          vertices_(config.produces<edm::SimVertexContainer>("g4SimHits")),
+          hcal_(config.produces<edm::PCaloHitContainer>("g4SimHits", "HcalHits")) {
+      for (std::size_t i = 0; i < kTrackerHitCollections.size(); ++i)
+        tracker_[i] = config.produces<edm::PSimHitContainer>("g4SimHits", kTrackerHitCollections[i]);
+      for (std::size_t i = 0; i < kEcalHitCollections.size(); ++i)
+        ecal_[i] = config.produces<edm::PCaloHitContainer>("g4SimHits", kEcalHitCollections[i]);
+      for (std::size_t i = 0; i < kMuonHitCollections.size(); ++i)
+        muon_[i] = config.produces<edm::PSimHitContainer>("g4SimHits", kMuonHitCollections[i]);
+    }
+
+    // Runs one event, the collections without synthetic hits are put empty
+    edm::test::Event test(edm::test::TestProcessor& tester, Event event) const {
+      std::array<std::unique_ptr<edm::PSimHitContainer>, kTrackerHitCollections.size()> tracker;
+      std::array<std::unique_ptr<edm::PCaloHitContainer>, kEcalHitCollections.size()> ecal;
+      std::array<std::unique_ptr<edm::PSimHitContainer>, kMuonHitCollections.size()> muon;
+      for (auto& collection : tracker)
+        collection = std::make_unique<edm::PSimHitContainer>();
+      for (auto& collection : ecal)
+        collection = std::make_unique<edm::PCaloHitContainer>();
+      for (auto& collection : muon)
+        collection = std::make_unique<edm::PSimHitContainer>();
+      *tracker[kTrackerCollection] = std::move(event.trackerHits);
+      *ecal[kEcalCollection] = std::move(event.ecalHits);
+      *muon[kMuonCollection] = std::move(event.muonHits);
+
+      auto products = std::tuple_cat(
+          std::make_tuple(std::make_pair(genParticles_, std::make_unique<reco::GenParticleCollection>(std::move(event.genParticles))),
+                          std::make_pair(tracks_, std::make_unique<edm::SimTrackContainer>(std::move(event.tracks))),
+                          std::make_pair(vertices_, std::make_unique<edm::SimVertexContainer>(std::move(event.vertices))),
+                          std::make_pair(hcal_, std::make_unique<edm::PCaloHitContainer>(std::move(event.hcalHits)))),
+          putPairs(tracker_, tracker, std::make_index_sequence<kTrackerHitCollections.size()>()),
+          putPairs(ecal_, ecal, std::make_index_sequence<kEcalHitCollections.size()>()),
+          putPairs(muon_, muon, std::make_index_sequence<kMuonHitCollections.size()>()));
+      return std::apply([&tester](auto&&... product) { return tester.test(std::move(product)...); }, std::move(products));
+    }
+
+  private:
+    edm::EDPutTokenT<reco::GenParticleCollection> genParticles_;
+    edm::EDPutTokenT<edm::SimTrackContainer> tracks_;
+    edm::EDPutTokenT<edm::SimVertexContainer> vertices_;
+    edm::EDPutTokenT<edm::PCaloHitContainer> hcal_;
+    std::array<edm::EDPutTokenT<edm::PSimHitContainer>, kTrackerHitCollections.size()> tracker_;
+    std::array<edm::EDPutTokenT<edm::PCaloHitContainer>, kEcalHitCollections.size()> ecal_;
+    std::array<edm::EDPutTokenT<edm::PSimHitContainer>, kMuonHitCollections.size()> muon_;
+  };
+
+}  // namespace synthetic
+
+#endif
@@ -0,0 +1,77 @@
+// Compares the per-event cost of matching hits to SimTracks with a linear std::find_if, as the
+// analyzer used to do, against the SimTrackIndex lookup.
+//
+// Run via: benchmarkSimTrackIndex [nTracks] [nHits] [nEvents]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/SimTrackIndex.h"
+
+namespace {
+  // Geant4 only stores a subset of the tracks it creates, so the saved ids are increasing but not contiguous
+  edm::SimTrackContainer makeTracks(std::size_t nTracks, std::mt19937& rng) {
+    std::uniform_int_distribution<unsigned int> gap(1, 4);
+    edm::SimTrackContainer tracks;
+    tracks.reserve(nTracks);
+    unsigned int trackId = 0;
+    for (std::size_t i = 0; i < nTracks; ++i) {
+      trackId += gap(rng);
+      SimTrack track(211, math::XYZTLorentzVectorD(1., 1., 1., 2.));
+      track.setTrackId(trackId);
+      tracks.push_back(track);
+    }
+    return tracks;
+  }
+}
+
+int main(int argc, char** argv) {
+  const std::size_t nTracks = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+  const std::size_t nHits = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100000;
+  const std::size_t nEvents = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 3;
+
+  std::mt19937 rng(12345);
+  const edm::SimTrackContainer tracks = makeTracks(nTracks, rng);
+  std::uniform_int_distribution<std::size_t> pick(0, tracks.size() - 1);
+  std::vector<unsigned int> hitTrackIds(nHits);
+  for (auto& trackId : hitTrackIds)
+    trackId = tracks[pick(rng)].trackId();
+
+  using clock = std::chrono::steady_clock;
+  double linearSeconds = 0., indexSeconds = 0.;
+  double linearSum = 0., indexSum = 0.;
+  SimTrackIndex index;
+
+  for (std::size_t event = 0; event < nEvents; ++event) {
+    auto start = clock::now();
+    for (auto trackId : hitTrackIds) {
+      auto simTrack = std::find_if(tracks.begin(), tracks.end(), [trackId](const SimTrack& track) {
+        return track.trackId() == trackId;
+      });
+      if (simTrack != tracks.end())
+        linearSum += simTrack->momentum().E();
+    }
+    linearSeconds += std::chrono::duration<double>(clock::now() - start).count();
+
+    start = clock::now();
+    index.build(tracks);
+    for (auto trackId : hitTrackIds) {
+      const SimTrack* simTrack = index.find(trackId);
+      if (simTrack != nullptr)
+        indexSum += simTrack->momentum().E();
+    }
+    indexSeconds += std::chrono::duration<double>(clock::now() - start).count();
+  }
+
+  std::cout << nTracks << " tracks, " << nHits << " hits, " << nEvents << " events\n"
+            << "  find_if      : " << 1e3 * linearSeconds / nEvents << " ms/event\n"
+            << "  SimTrackIndex: " << 1e3 * indexSeconds / nEvents << " ms/event ("
+            << (index.isDense() ? "dense" : "hashed") << ")\n";
+
+  // Both lookups must have matched exactly the same tracks
+  return linearSum == indexSum ? 0 : 1;
+}
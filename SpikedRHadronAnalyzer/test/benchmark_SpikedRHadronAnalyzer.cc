@@ -0,0 +1,132 @@
+// Runs SpikedRHadronAnalyzer on synthetic events in a TestProcessor and reports the event rate and
+// the heap allocations per event, so changes to the hit loops can be timed without GEN-SIM input.
+// The hits are split 60% tracker, 25% ECAL, 10% HCAL and 5% muon. The first event builds the
+// geometry cache and is not timed. Empty events are run first, their cost (framework and product
+// handling) is reported separately so the analyzer's own share can be read off.
+//
+// Run via: benchmarkSpikedRHadronAnalyzer [nTracks] [nHits] [nEvents] [outputFormat] [outputMode] [minEventsPerSecond]
+// The exit status is 1 when the rate is below minEventsPerSecond (0, the default, disables the check).
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "RHadronProduction/SpikedRHadronAnalyzer/test/SyntheticEvent.h"
+
+namespace {
+  std::atomic<std::size_t> g_allocations{0};
+  std::atomic<std::size_t> g_allocatedBytes{0};
+
+  struct Counts {
+    std::size_t allocations = g_allocations.load(std::memory_order_relaxed);
+    std::size_t bytes = g_allocatedBytes.load(std::memory_order_relaxed);
+  };
+}
+
+// Every allocation of the process is counted, including those of the framework and the output thread
+void* operator new(std::size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  return std::malloc(size ? size : 1);
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+int main(int argc, char** argv) {
+  const std::size_t nTracks = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+  const std::size_t nHits = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100000;
+  const std::size_t nEvents = std::max<std::size_t>(argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 10, 1);
+  const std::string outputFormat = argc > 4 ? argv[4] : "csv";
+  const std::string outputMode = argc > 5 ? argv[5] : "hits";
+  const double minRate = argc > 6 ? std::strtod(argv[6], nullptr) : 0.;
+  const std::string outputFile = "benchmark_SpikedRHadronAnalyzer." + outputFormat;
+
+  synthetic::Config sizes;
+  sizes.tracks = nTracks;
+  sizes.trackerHits = nHits * 60 / 100;
+  sizes.ecalHits = nHits * 25 / 100;
+  sizes.hcalHits = nHits * 10 / 100;
+  sizes.muonHits = nHits - sizes.trackerHits - sizes.ecalHits - sizes.hcalHits;
+  synthetic::Config empty;
+  empty.tracks = 0;
+  empty.trackerHits = 0;
+
+  // Events are made up front so only the analyzer and the framework are timed
+  std::mt19937 rng(12345);
+  std::vector<synthetic::Event> events;
+  for (std::size_t i = 0; i <= nEvents; ++i)
+    events.push_back(synthetic::makeEvent(sizes, rng));
+  std::vector<synthetic::Event> emptyEvents;
+  for (std::size_t i = 0; i < nEvents; ++i)
+    emptyEvents.push_back(synthetic::makeEvent(empty, rng));
+
+  using clock = std::chrono::steady_clock;
+  double emptySeconds = 0., seconds = 0.;
+  Counts emptyStart, emptyEnd, start, end;
+  clock::time_point endJob;
+  {
+    edm::test::TestProcessor::Config config{synthetic::analyzerConfig(outputFile, outputFormat, outputMode)};
+    synthetic::Products products(config);
+    edm::test::TestProcessor tester(config);
+    products.test(tester, std::move(events[0]));
+
+    emptyStart = Counts();
+    auto begin = clock::now();
+    for (auto& event : emptyEvents)
+      products.test(tester, std::move(event));
+    emptySeconds = std::chrono::duration<double>(clock::now() - begin).count();
+    emptyEnd = Counts();
+
+    start = Counts();
+    begin = clock::now();
+    for (std::size_t i = 1; i <= nEvents; ++i)
+      products.test(tester, std::move(events[i]));
+    seconds = std::chrono::duration<double>(clock::now() - begin).count();
+    end = Counts();
+
+    // The output thread finishes and the files are closed when the processor ends the job
+    endJob = clock::now();
+  }
+  const double endJobSeconds = std::chrono::duration<double>(clock::now() - endJob).count();
+
+  for (const char* suffix : {"", "_detIds", "_histograms", "_etaPhi"}) {
+    const std::string stem = outputFile.substr(0, outputFile.rfind('.'));
+    std::remove((stem + suffix + "." + outputFormat).c_str());
+  }
+  std::remove((outputFile + ".idx").c_str());
+
+  const double rate = nEvents / seconds;
+  const double perEvent = 1. / nEvents;
+  std::cout << nTracks << " tracks, " << nHits << " hits, " << nEvents << " events, " << outputFormat << " " << outputMode << "\n"
+            << "  analyzer + framework: " << rate << " events/s, " << 1e3 * seconds * perEvent << " ms/event, "
+            << nHits * rate << " hits/s\n"
+            << "  allocations         : " << (end.allocations - start.allocations) * perEvent << " per event, "
+            << (end.bytes - start.bytes) * perEvent / 1e6 << " MB/event\n"
+            << "  empty events        : " << 1e3 * emptySeconds * perEvent << " ms/event, "
+            << (emptyEnd.allocations - emptyStart.allocations) * perEvent << " allocations per event\n"
+            << "  end of job          : " << endJobSeconds << " s\n";
+
+  if (minRate > 0. && rate < minRate) {
+    std::cout << "  below the required " << minRate << " events/s\n";
+    return 1;
+  }
+  return 0;
+}
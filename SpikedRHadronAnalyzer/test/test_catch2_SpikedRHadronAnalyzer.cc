@@ -1,51 +1,311 @@
 #include "catch.hpp"
 #include "FWCore/TestProcessor/interface/TestProcessor.h"
 #include "FWCore/Utilities/interface/Exception.h"
+#include "RHadronProduction/SpikedRHadronAnalyzer/interface/HitDumpReader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "RHadronProduction/SpikedRHadronAnalyzer/test/SyntheticEvent.h"
 
 static constexpr auto s_tag = "[SpikedRHadronAnalyzer]";
 
-TEST_CASE("Standard checks of SpikedRHadronAnalyzer", s_tag) {
-  const std::string baseConfig{
-R"_(from FWCore.TestProcessor.TestProcess import *
-process = TestProcess()
-process.toTest = cms.EDProducer("SpikedRHadronAnalyzer"
-#necessary configuration parameters
- )
-process.moduleToTest(process.toTest)
-)_"
+namespace {
+  struct CsvRow {
+    unsigned long long event;
+    std::vector<std::string> fields;  // the columns after Event
+
+    double value(std::size_t column) const { return std::stod(fields.at(column)); }
   };
-  
-  edm::test::TestProcessor::Config config{ baseConfig };  
+
+  // Rows of a CSV file written by the analyzer, without the header
+  std::vector<CsvRow> readCsv(const std::string& fileName) {
+    std::vector<CsvRow> rows;
+    std::ifstream file(fileName);
+    std::string line;
+    std::getline(file, line);
+    while (std::getline(file, line)) {
+      std::istringstream fields(line);
+      std::string field;
+      CsvRow row;
+      std::getline(fields, field, ',');
+      row.event = std::stoull(field);
+      while (std::getline(fields, field, ','))
+        row.fields.push_back(field);
+      rows.push_back(row);
+    }
+    return rows;
+  }
+
+  // Columns of the hit dump after Event
+  enum Column { kEnergy = 0, kX, kY, kZ, kR, kPdg, kTrackEnergy, kPx, kPy, kPz, kParentPdg, kRHadron, kColumns };
+
+  // Compares the rows of one event with the synthetic hits it was made from
+  void checkRows(const std::vector<CsvRow>& rows, const std::vector<synthetic::ExpectedRow>& expected) {
+    REQUIRE(rows.size() == expected.size());
+    std::set<long> seen;
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+      const CsvRow& row = rows[i];
+      REQUIRE(row.fields.size() == kColumns);
+      const long energy = std::lround(row.value(kEnergy) * 1e3);
+      INFO("row " << i << " energy " << row.value(kEnergy));
+      CHECK(seen.insert(energy).second);  // a hit written twice shows up here
+      CHECK(energy == expected[i].energyMeV);
+      CHECK(static_cast<int>(row.value(kPdg)) == expected[i].pdg);
+      CHECK(row.value(kTrackEnergy) == Approx(expected[i].trackEnergy));
+      CHECK(static_cast<int>(row.value(kParentPdg)) == expected[i].parentPdg);
+      CHECK(static_cast<int>(row.value(kRHadron)) == expected[i].rHadron);
+      CHECK(row.value(kR) == Approx(std::hypot(row.value(kX), row.value(kY))).epsilon(1e-4).margin(1e-4));
+    }
+  }
+}
+
+TEST_CASE("SpikedRHadronAnalyzer on synthetic events", s_tag) {
+  const std::string outputFile = "test_SpikedRHadronAnalyzer.csv";
+  std::remove(outputFile.c_str());
+  std::remove(hitIndexFileName(outputFile).c_str());
+  std::mt19937 rng(12345);
+
   SECTION("base configuration is OK") {
+    edm::test::TestProcessor::Config config{synthetic::analyzerConfig(outputFile)};
     REQUIRE_NOTHROW(edm::test::TestProcessor(config));
   }
-  
-  SECTION("No event data") {
-    edm::test::TestProcessor tester(config);
-    
-    REQUIRE_THROWS_AS(tester.test(), cms::Exception);
-    //If the module does not throw when given no data, substitute 
-    //REQUIRE_NOTHROW for REQUIRE_THROWS_AS
-  }
-  
+
   SECTION("beginJob and endJob only") {
+    edm::test::TestProcessor::Config config{synthetic::analyzerConfig(outputFile)};
     edm::test::TestProcessor tester(config);
-    
     REQUIRE_NOTHROW(tester.testBeginAndEndJobOnly());
   }
 
   SECTION("Run with no LuminosityBlocks") {
+    edm::test::TestProcessor::Config config{synthetic::analyzerConfig(outputFile)};
     edm::test::TestProcessor tester(config);
-    
     REQUIRE_NOTHROW(tester.testRunWithNoLuminosityBlocks());
   }
 
   SECTION("LuminosityBlock with no Events") {
+    edm::test::TestProcessor::Config config{synthetic::analyzerConfig(outputFile)};
     edm::test::TestProcessor tester(config);
-    
     REQUIRE_NOTHROW(tester.testLuminosityBlockWithNoEvents());
   }
 
-}
+  SECTION("events without the SimHit collections are skipped") {
+    {
+      edm::test::TestProcessor::Config config{synthetic::analyzerConfig(outputFile)};
+      edm::test::TestProcessor tester(config);
+      REQUIRE_NOTHROW(tester.test());
+    }
+    REQUIRE(readCsv(outputFile).empty());
+  }
+
+  SECTION("every tracker hit with a SimTrack is written once") {
+    synthetic::Config sizes;
+    sizes.tracks = 2000;
+    sizes.trackerHits = 20000;
+    sizes.unmatchedFraction = 0.1;
+    const synthetic::Event event = synthetic::makeEvent(sizes, rng);
+    const auto expected = synthetic::expectedRows(event);
+    REQUIRE(expected.size() < sizes.trackerHits);
+    {
+      edm::test::TestProcessor::Config config{synthetic::analyzerConfig(outputFile)};
+      synthetic::Products products(config);
+      edm::test::TestProcessor tester(config);
+      REQUIRE_NOTHROW(products.test(tester, event));
+    }
+    checkRows(readCsv(outputFile), expected);
+  }
 
-//Add additional TEST_CASEs to exercise the modules capabilities
+  SECTION("all subdetectors over several events") {
+    synthetic::Config sizes;
+    sizes.tracks = 1000;
+    sizes.trackerHits = 3000;
+    sizes.ecalHits = 2000;
+    sizes.hcalHits = 1000;
+    sizes.muonHits = 500;
+    sizes.unmatchedFraction = 0.05;
+    std::vector<std::vector<synthetic::ExpectedRow>> expected;
+    {
+      edm::test::TestProcessor::Config config{synthetic::analyzerConfig(outputFile)};
+      synthetic::Products products(config);
+      edm::test::TestProcessor tester(config);
+      for (int i = 0; i < 3; ++i) {
+        synthetic::Event event = synthetic::makeEvent(sizes, rng);
+        expected.push_back(synthetic::expectedRows(event));
+        REQUIRE_NOTHROW(products.test(tester, std::move(event)));
+      }
+    }
+
+    // Rows come grouped by event, in event-number order
+    const auto rows = readCsv(outputFile);
+    std::vector<std::vector<CsvRow>> events;
+    for (const auto& row : rows) {
+      if (events.empty() || row.event != events.back().front().event) {
+        REQUIRE((events.empty() || row.event > events.back().front().event));
+        events.emplace_back();
+      }
+      events.back().push_back(row);
+    }
+    REQUIRE(events.size() == expected.size());
+    for (std::size_t i = 0; i < events.size(); ++i)
+      checkRows(events[i], expected[i]);
+  }
+
+  SECTION("the index reads single events back") {
+    synthetic::Config sizes;
+    sizes.tracks = 300;
+    sizes.trackerHits = 600;
+    sizes.ecalHits = 400;
+    sizes.hcalHits = 200;
+    sizes.muonHits = 100;
+    {
+      edm::test::TestProcessor::Config config{synthetic::analyzerConfig(outputFile)};
+      synthetic::Products products(config);
+      edm::test::TestProcessor tester(config);
+      for (int i = 0; i < 3; ++i)
+        REQUIRE_NOTHROW(products.test(tester, synthetic::makeEvent(sizes, rng)));
+    }
+
+    const auto rows = readCsv(outputFile);
+    HitDumpReader reader(outputFile);
+    REQUIRE(reader.size() == 3);
+    std::size_t first = 0;
+    HitColumns hits;
+    for (std::size_t i = 0; i < reader.size(); ++i) {
+      const HitIndexEntry& entry = reader.entry(i);
+      INFO("event " << entry.event);
+      REQUIRE(reader.find(entry.event) == &entry);
+      REQUIRE(reader.hits(entry.event, hits));
+      REQUIRE(hits.size() == entry.rows);
+      REQUIRE(first + hits.size() <= rows.size());
+      double energy = 0.;
+      for (std::size_t j = 0; j < hits.size(); ++j) {
+        const CsvRow& row = rows[first + j];
+        CHECK(row.event == entry.event);
+        CHECK(hits.energy[j] == Approx(row.value(kEnergy)));
+        CHECK(hits.pdg[j] == static_cast<int>(row.value(kPdg)));
+        CHECK(hits.rHadron[j] == static_cast<int>(row.value(kRHadron)));
+        energy += row.value(kEnergy);
+      }
+      first += hits.size();
+      CHECK(entry.energy[0] + entry.energy[1] + entry.energy[2] + entry.energy[3] == Approx(energy).epsilon(1e-4));
+      CHECK(entry.energy[static_cast<std::size_t>(HitIndexDetector::Muon)] > 0.f);
+
+      // The synthetic R-hadrons move along z with E = 10 and 11 GeV
+      CHECK(entry.rHadronMomentum[0][2] == Approx(5.));
+      CHECK(entry.rHadronMomentum[0][3] == Approx(10.));
+      CHECK(entry.rHadronMomentum[1][3] == Approx(11.));
+    }
+    CHECK(first == rows.size());
+    CHECK(reader.rows(reader.entry(0).event + 1000).empty());
+    CHECK_FALSE(reader.hits(reader.entry(0).event + 1000, hits));
+  }
+
+  SECTION("ROI mode keeps the hits in the cones and above the threshold") {
+    synthetic::Config sizes;
+    sizes.tracks = 500;
+    sizes.trackerHits = 2000;
+    sizes.ecalHits = 2000;
+    sizes.hcalHits = 1000;
+    sizes.muonHits = 500;
+    const synthetic::Event event = synthetic::makeEvent(sizes, rng);
+    const double cone = 0.5;
+    const double threshold = 4.0005;  // GeV, between the deposits of hits 4000 and 4001
+
+    auto run = [&](bool roiMode) {
+      {
+        edm::test::TestProcessor::Config config{synthetic::analyzerConfig(outputFile, "csv", "hits", "", roiMode, cone, threshold)};
+        synthetic::Products products(config);
+        edm::test::TestProcessor tester(config);
+        REQUIRE_NOTHROW(products.test(tester, event));
+      }
+      return readCsv(outputFile);
+    };
+    const auto all = run(false);
+    const auto kept = run(true);
+
+    // Distance of a written hit to the nearest R-hadron, from its position in the CSV
+    auto deltaR = [](const CsvRow& row) {
+      const double eta = std::asinh(row.value(kZ) / row.value(kR));
+      const double phi = std::atan2(row.value(kY), row.value(kX));
+      double nearest = 1e9;
+      for (const auto& direction : synthetic::kRHadronDirections) {
+        const double dPhi = std::remainder(phi - direction[1], 2. * M_PI);
+        nearest = std::min(nearest, std::hypot(eta - direction[0], dPhi));
+      }
+      return nearest;
+    };
+
+    // The CSV keeps 6 digits, hits within 1e-3 of the cone edge may fall either way
+    std::set<long> keptEnergies, expectedEnergies, borderline;
+    for (const auto& row : kept)
+      keptEnergies.insert(std::lround(row.value(kEnergy) * 1e3));
+    for (const auto& row : all) {
+      const long energy = std::lround(row.value(kEnergy) * 1e3);
+      const double distance = deltaR(row);
+      if (row.value(kEnergy) < threshold && std::abs(distance - cone) < 1e-3)
+        borderline.insert(energy);
+      else if (row.value(kEnergy) >= threshold || distance < cone)
+        expectedEnergies.insert(energy);
+    }
+    for (const long energy : borderline)
+      keptEnergies.erase(energy);
+    REQUIRE(kept.size() < all.size());
+    CHECK(keptEnergies == expectedEnergies);
+  }
+
+  SECTION("summary mode keeps the deposited energy") {
+    synthetic::Config sizes;
+    sizes.tracks = 500;
+    sizes.trackerHits = 2000;
+    sizes.ecalHits = 1000;
+    sizes.hcalHits = 500;
+    sizes.muonHits = 200;
+    const synthetic::Event event = synthetic::makeEvent(sizes, rng);
+    double expectedEnergy = 0.;
+    for (const auto& row : synthetic::expectedRows(event))
+      expectedEnergy += row.energyMeV * 1e-3;
+    {
+      edm::test::TestProcessor::Config config{synthetic::analyzerConfig(outputFile, "csv", "summary")};
+      synthetic::Products products(config);
+      edm::test::TestProcessor tester(config);
+      REQUIRE_NOTHROW(products.test(tester, event));
+    }
+    const std::string detIdFile = "test_SpikedRHadronAnalyzer_detIds.csv";
+    double energy = 0.;
+    for (const auto& row : readCsv(detIdFile))
+      energy += row.value(row.fields.size() - 1);
+    CHECK(energy == Approx(expectedEnergy).epsilon(1e-4));
+    std::remove(detIdFile.c_str());
+    std::remove("test_SpikedRHadronAnalyzer_histograms.csv");
+    std::remove("test_SpikedRHadronAnalyzer_etaPhi.csv");
+  }
+
+  SECTION("profile of the stages") {
+    const std::string profileFile = "test_SpikedRHadronAnalyzer_profile.json";
+    synthetic::Config sizes;
+    sizes.ecalHits = 100;
+    {
+      edm::test::TestProcessor::Config config{synthetic::analyzerConfig(outputFile, "csv", "hits", profileFile)};
+      synthetic::Products products(config);
+      edm::test::TestProcessor tester(config);
+      for (int i = 0; i < 2; ++i)
+        REQUIRE_NOTHROW(products.test(tester, synthetic::makeEvent(sizes, rng)));
+    }
+    std::ifstream file(profileFile);
+    const std::string profile((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    CHECK(profile.find("\"events\": 2,") != std::string::npos);
+    CHECK(profile.find("\"tracker\": {\"calls\": 2,") != std::string::npos);
+    std::remove(profileFile.c_str());
+  }
+
+  std::remove(outputFile.c_str());
+  std::remove(hitIndexFileName(outputFile).c_str());
+}
@@ -0,0 +1,118 @@
+import sys
+import os
+import re
+import argparse
+import glob
+import json
+from datetime import datetime
+
+#Builds the per-mass cost model used by submitColbyProdToCondor.py (-c) from the condor logs of earlier productions.
+#The log names written by the submitter carry the mass and the events of the job:
+#    condorMonitoringOutput/<date>/production_M<mass>_job<N>_Events<events>_log.log
+#For every job that terminated normally the wall time (execution to termination) and the peak memory are read,
+#and per mass the wall time is fitted as overhead + secondsPerEvent * events.
+
+logNamePattern = re.compile(r"production_M(\d+)_job\d+_Events(\d+)_log\.log$")
+eventPattern   = re.compile(r"^(\d{3}) \([\d.]+\) (\S+) (\S+)")
+returnPattern  = re.compile(r"Normal termination \(return value (\d+)\)")
+memoryPattern  = re.compile(r"^\s*Memory \(MB\)\s*:\s*(\d+)")
+cpusPattern    = re.compile(r"^\s*Cpus\s*:\s*\S*\s+(\d+)")
+
+def parseTime(day,clock,year):
+    #Newer condor versions write ISO dates, older ones month/day without a year
+    if "-" in day:
+        return datetime.strptime(day+" "+clock,"%Y-%m-%d %H:%M:%S")
+    return datetime.strptime(str(year)+"/"+day+" "+clock,"%Y/%m/%d %H:%M:%S")
+
+def parseLog(logName):
+    #Returns (wall seconds, peak memory in MB, requested cpus) of a successful job, None otherwise
+    year = datetime.fromtimestamp(os.path.getmtime(logName)).year
+    executing = None
+    terminated = None
+    exitCode = None
+    memory = None
+    cpus = 1
+    with open(logName) as log:
+        for line in log:
+            event = eventPattern.match(line)
+            if event:
+                code = event.group(1)
+                if code == "001":#job executing, a restarted job keeps the last start
+                    executing = parseTime(event.group(2),event.group(3),year)
+                elif code == "005":#job terminated
+                    terminated = parseTime(event.group(2),event.group(3),year)
+                continue
+            status = returnPattern.search(line)
+            if status:
+                exitCode = int(status.group(1))
+            usage = memoryPattern.match(line)
+            if usage:
+                memory = max(memory or 0,int(usage.group(1)))
+            request = cpusPattern.match(line)
+            if request:
+                cpus = int(request.group(1))
+    if executing is None or terminated is None or exitCode != 0:
+        return None
+    wall = (terminated - executing).total_seconds()
+    if terminated < executing:#year wrapped during the job
+        wall += 365*24*3600
+    return wall,memory,cpus
+
+def fitMass(jobs):
+    #Least squares of wall = overhead + perEvent*events, a single event count only gives the slope through zero
+    n     = float(len(jobs))
+    sx    = sum(j["events"] for j in jobs)
+    sy    = sum(j["wall"] for j in jobs)
+    sxx   = sum(j["events"]**2 for j in jobs)
+    sxy   = sum(j["events"]*j["wall"] for j in jobs)
+    denom = n*sxx - sx*sx
+    overhead = 0.0
+    perEvent = sxy/sxx
+    if denom > 0:
+        perEvent = (n*sxy - sx*sy)/denom
+        overhead = (sy - perEvent*sx)/n
+        if perEvent <= 0 or overhead < 0:#noise dominated, keep the proportional model
+            overhead = 0.0
+            perEvent = sxy/sxx
+    memories = [j["memory"] for j in jobs if j["memory"] is not None]
+    return {
+        "jobs"            : len(jobs),
+        "secondsPerEvent" : perEvent,
+        "overheadSeconds" : overhead,
+        "maxWallSeconds"  : max(j["wall"] for j in jobs),
+        "peakMemoryMB"    : max(memories) if memories else None,
+    }
+
+if __name__=='__main__':
+    parser = argparse.ArgumentParser()
+    parser.add_argument("-l","--logs",type=str,default="condorMonitoringOutput/*/production_M*_log.log",help="glob of the condor logs to read")
+    parser.add_argument("-t","--threads",type=int,default=1,help="only use jobs that requested this many cpus, the cost depends on it")
+    parser.add_argument("-o","--output",type=str,default="costModel.json",help="cost model .json to write")
+    args = parser.parse_args()
+
+    jobsPerMass = {}
+    skipped = 0
+    for logName in sorted(glob.glob(args.logs)):
+        name = logNamePattern.search(os.path.basename(logName))
+        if not name:
+            continue
+        job = parseLog(logName)
+        if job is None or job[2] != args.threads:
+            skipped += 1
+            continue
+        jobsPerMass.setdefault(name.group(1),[]).append({"events":int(name.group(2)),"wall":job[0],"memory":job[1]})
+
+    if not jobsPerMass:
+        print("No successful jobs found in {0}, no cost model written".format(args.logs))
+        sys.exit(1)
+
+    model = {"threads" : args.threads, "masses" : {}}
+    for mass in sorted(jobsPerMass,key=int):
+        model["masses"][mass] = fitMass(jobsPerMass[mass])
+        cost = model["masses"][mass]
+        print("M = {0}: {1} jobs, {2:.1f} s/event + {3:.0f} s, peak memory {4} MB".format(mass,cost["jobs"],cost["secondsPerEvent"],cost["overheadSeconds"],cost["peakMemoryMB"]))
+    print("Skipped {0} failed, unfinished or differently threaded jobs".format(skipped))
+
+    with open(args.output,"w") as f:
+        json.dump(model,f,indent=2,sort_keys=True)
+    print("Cost model written to {0}".format(args.output))
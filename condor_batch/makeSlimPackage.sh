@@ -0,0 +1,79 @@
+#!/bin/bash
+
+# Purpose: Builds the slim package shipped to the condor jobs instead of a tarball of the whole CMSSW area.
+#          It holds only what runGenerator.sh needs on top of a fresh release area: the compiled
+#          RHadronProduction libraries and plugins, their python configs and the production scripts.
+#          With ntuple=true in gensimToNTuple.sh it also holds the NTuplizer: the SUSYBSMAnalysis
+#          libraries, python configs and data files, the HSCP config and its dE/dx template.
+#          The package is named after the hash of its content, so an unchanged build gives the same
+#          name and the jobs keep reusing the copy already unpacked on their node.
+#          Run it from condor_batch after scram b, it prints the package name on the last line.
+
+set -e
+
+area=$(cd ../../.. && pwd)
+release=$(basename $area)
+arch=$(ls $area/lib)
+if [ -z "$arch" ] || [ $(echo $arch | wc -w) -ne 1 ]; then
+    echo "expected a single architecture in $area/lib, found '$arch', run scram b first" >&2
+    exit 1
+fi
+if ! ls $area/lib/$arch/*RHadronProduction* > /dev/null 2>&1; then
+    echo "no RHadronProduction libraries in $area/lib/$arch, run scram b first" >&2
+    exit 1
+fi
+
+ntuple=false
+if grep -q "^ntuple=true" ../gensimToNTuple.sh; then
+    ntuple=true
+    if ! ls $area/lib/$arch/*SUSYBSMAnalysis* > /dev/null 2>&1; then
+        echo "ntuple=true in gensimToNTuple.sh but no SUSYBSMAnalysis libraries in $area/lib/$arch, build it or set ntuple=false" >&2
+        exit 1
+    fi
+fi
+
+staging=$(mktemp -d)
+trap "rm -rf $staging $staging.tar" EXIT
+
+# libraries and plugins, the plugin cache is rebuilt on the node
+mkdir -p $staging/lib/$arch
+cp -L $area/lib/$arch/*RHadronProduction* $staging/lib/$arch/
+
+# python configs as scram installs them, importable as RHadronProduction.SpikedRHadronAnalyzer
+mkdir -p $staging/python
+cp -rL $area/python/RHadronProduction $staging/python/
+
+# the scripts run by the job, laid out as in src/RHadronProduction
+mkdir -p $staging/RHadronProduction/SpikedRHadronAnalyzer
+cp ../gensimToNTuple.sh $staging/RHadronProduction/
+cp ../SpikedRHadronAnalyzer/EXO-RunIISummer20UL18GENSIM-00010_1_cfg_v3.py $staging/RHadronProduction/SpikedRHadronAnalyzer/
+cp -r ../SpikedRHadronAnalyzer/python $staging/RHadronProduction/SpikedRHadronAnalyzer/
+mkdir -p $staging/RHadronProduction/condor_batch
+cp stageOut.py $staging/RHadronProduction/condor_batch/
+
+# the NTuplizer, its data files go under src so FileInPath finds them in the release area
+if $ntuple; then
+    cp -L $area/lib/$arch/*SUSYBSMAnalysis* $staging/lib/$arch/
+    cp -rL $area/python/SUSYBSMAnalysis $staging/python/
+    for data in $(cd $area/src && find SUSYBSMAnalysis -type d -name data); do
+        mkdir -p $staging/src/$data
+        cp -rL $area/src/$data/. $staging/src/$data/
+    done
+    cp ../HSCParticleProducerAnalyzer_2018_SignalMC_cfg.py ../template_2018MC_v5.root $staging/RHadronProduction/
+fi
+
+find $staging -name "*.pyc" -delete
+find $staging -name __pycache__ -type d -prune -exec rm -rf {} +
+echo "$release $arch" > $staging/release
+
+# same content gives the same bytes: fixed order, times and owners
+tar --sort=name --mtime=@0 --owner=0 --group=0 --numeric-owner -cf $staging.tar -C $staging .
+hash=$(sha256sum $staging.tar | cut -c1-16)
+package="rhadronSlim_${hash}.tar.gz"
+if [ ! -f $package ]; then
+    gzip -n -c $staging.tar > $package
+fi
+rm -f $staging.tar
+
+echo "Packaged $release $arch: $(du -h $package | cut -f1)" >&2
+echo $package
@@ -9,14 +9,59 @@ echo "Starting job on " `date` #Date/time of start of job
 echo "Running on: `uname -a`" #Condor job is running on this node
 echo "System software: `cat /etc/redhat-release`" #Operating System on that node
 
-#untar your crap
+#Set up the software from the slim package of makeSlimPackage.sh (argument 10)
+#The release area with the package installed is built once per node and package, under RHADRON_CACHE,
+#later jobs on the node only source it. The job itself runs in its own copy of the script layout.
 source /cvmfs/cms.cern.ch/cmsset_default.sh
-echo "Untaring  directory with analyzer code"
-tar -xf cmsswTar.tar.gz
-cd CMSSW_10_6_47/src/
-scram b ProjectRename
-cmsenv
-cd RHadronProduction
+package=${10}
+scratch=${_CONDOR_SCRATCH_DIR:-$PWD}
+cache=${RHADRON_CACHE:-/tmp/${USER:-condor}_rhadron_cache}
+if ! mkdir -p $cache 2> /dev/null || [ ! -w $cache ]; then
+    echo "cache $cache not writable, unpacking in the job directory"
+    cache=$scratch/cache
+    mkdir -p $cache
+fi
+area=$cache/${package%.tar.gz}
+
+(
+    flock 9
+    if [ ! -f $area/.complete ]; then
+        echo "Installing $package in $area"
+        rm -rf $area
+        mkdir -p $area/package
+        tar -xzf $scratch/$package -C $area/package
+        read release arch < $area/package/release
+        cd $area
+        SCRAM_ARCH=$arch scram project CMSSW $release
+        cp -r package/lib/$arch/. $release/lib/$arch/
+        cp -r package/python/. $release/python/
+        if [ -d package/src ]; then
+            cp -r package/src/. $release/src/
+        fi
+        cd $release/src
+        eval `scramv1 runtime -sh`
+        edmPluginRefresh $CMSSW_BASE/lib/$arch
+        touch $area/.complete
+    else
+        echo "Reusing $package installed in $area"
+    fi
+) 9> $cache/.lock
+
+read release arch < $area/package/release
+cd $area/$release/src
+eval `scramv1 runtime -sh`
+
+#The scripts write their files next to themselves, so every job gets its own directory of links
+mkdir -p $scratch/RHadronProduction/SpikedRHadronAnalyzer/data
+cd $scratch/RHadronProduction
+ln -sf $area/package/RHadronProduction/gensimToNTuple.sh .
+ln -sf $area/package/RHadronProduction/SpikedRHadronAnalyzer/EXO-RunIISummer20UL18GENSIM-00010_1_cfg_v3.py SpikedRHadronAnalyzer/
+ln -sf $area/package/RHadronProduction/SpikedRHadronAnalyzer/python SpikedRHadronAnalyzer/
+for file in HSCParticleProducerAnalyzer_2018_SignalMC_cfg.py template_2018MC_v5.root; do
+    if [ -f $area/package/RHadronProduction/$file ]; then
+        ln -sf $area/package/RHadronProduction/$file .
+    fi
+done
 
 #Arguments taken
 #1 - R-hadron mass
@@ -26,6 +71,10 @@ cd RHadronProduction
 #5 - generator seed
 #6 - g4 seed
 #7 - vtx smearing seed
+#8 - number of threads (optional, 1 by default)
+#9 - number of streams (optional, 0 means one per thread)
+#10 - slim software package made by makeSlimPackage.sh
+#11 - events per checkpoint block of the GEN-SIM step (optional, 0 disables checkpoints)
 
 #Running the selection maker
 echo "Beginning the production"
@@ -43,23 +92,75 @@ echo "GEANT4 seed: "
 echo $6
 echo "Vtx smearing seed: "
 echo $7
+echo "Threads and streams: "
+echo ${8:-1} ${9:-0}
+echo "Events per checkpoint block: "
+echo ${11:-0}
+
+#Stage-out runs next to the production, every file is copied to eos as soon as its step is done
+#Files that are not shipped leave the local disk once no later step reads them
+stageIntermediate=false # Set to true to also copy the GEN-SIM, DIGI-RAW and HLT files
+includes="-i M*reco*.root -i M*genSimReport*.json"
+if $stageIntermediate; then
+    includes="-i M*.root -i M*genSimReport*.json"
+fi
+queue=$scratch/stageOut.queue
+: > $queue
+python $area/package/RHadronProduction/condor_batch/stageOut.py $3 -q $queue $includes -j 4 -r 3 -b 10 --remove &
+stageOutPid=$!
+
+#Checkpoint blocks are mirrored to eos as they complete, an evicted job restarting on any node downloads them
+#and resumes after the last complete block. gensimToNTuple.sh checks the seeds and checksums of every block.
+checkpoints=${11:-0}
+if [[ $checkpoints -gt 0 ]]; then
+    eosRest=${3#root://}
+    eosHost=root://${eosRest%%/*}
+    checkpointPath=/${eosRest#*/}/checkpoints
+    mkdir -p SpikedRHadronAnalyzer/data/checkpoint
+    for FILE in $(xrdfs $eosHost ls $checkpointPath 2> /dev/null | grep "/M${1}_CM[0-9]*_pythia8_jobNum${4}_block")
+    do
+        echo "restoring checkpoint ${FILE##*/}"
+        xrdcp -f -s $eosHost/$FILE SpikedRHadronAnalyzer/data/checkpoint/
+    done
+    checkpointQueue=$scratch/checkpoint.queue
+    : > $checkpointQueue
+    python $area/package/RHadronProduction/condor_batch/stageOut.py $eosHost/$checkpointPath -q $checkpointQueue -j 2 -r 3 -b 10 &
+    checkpointPid=$!
+fi
 
-./gensimToNTuple.sh $1 $2 $4 $5 $6 $7
+#The outputs of the steps that did finish are still staged out when a later step fails
+STAGEOUT_QUEUE=$queue CHECKPOINT_QUEUE=$checkpointQueue ./gensimToNTuple.sh $1 $2 $4 $5 $6 $7 ${8:-1} ${9:-0} $checkpoints
+PRODUCTIONEXIT=$?
+if [[ $PRODUCTIONEXIT -ne 0 ]]; then
+    echo "failure in the production, exit code $PRODUCTIONEXIT"
+fi
+echo "done" >> $queue
 
-for FILE in SpikedRHadronAnalyzer/data/M*reco*.root
-do
-    echo "Full path: ${FILE}"
-    echo "copying ${FILE##*\/} to eos $3"
-    xrdcp ${FILE} $3/${FILE##*\/}
-    XRDEXIT=$?
-    if [[ $XRDEXIT -ne 0 ]]; then
-	echo "failure in xrdcp, exit code $XRDEXIT"
+wait $stageOutPid
+STAGEOUTEXIT=$?
+if [[ $STAGEOUTEXIT -ne 0 ]]; then
+    echo "failure in stage-out, exit code $STAGEOUTEXIT"
+fi
+
+#The checkpoints are only needed until the outputs are safely on eos
+if [[ $checkpoints -gt 0 ]]; then
+    echo "done" >> $checkpointQueue
+    wait $checkpointPid
+    if [[ $PRODUCTIONEXIT -eq 0 ]] && [[ $STAGEOUTEXIT -eq 0 ]] && xrdfs $eosHost ls /${eosRest#*/} 2> /dev/null | grep -q "/M${1}_CM[0-9]*_pythia8_jobNum${4}_recoM"; then
+        for FILE in $(xrdfs $eosHost ls $checkpointPath 2> /dev/null | grep "/M${1}_CM[0-9]*_pythia8_jobNum${4}_block")
+        do
+            xrdfs $eosHost rm $FILE
+        done
     fi
-done
+fi
 
-#clean up
+#clean up, the installed package stays in the cache for the next job
 echo "cleaning up"
-cd ${_CONDOR_SCRATCH_DIR_}
-rm -rf CMSSW_10_6_30
-rm cmsswTar.tar.gz
+cd $scratch
+rm -rf RHadronProduction
+rm -f $package
+if [[ $PRODUCTIONEXIT -ne 0 ]]; then
+    exit $PRODUCTIONEXIT
+fi
+exit $STAGEOUTEXIT
 
@@ -0,0 +1,200 @@
+import sys
+import os
+import time
+import argparse
+import fnmatch
+import shutil
+import subprocess
+import threading
+import zlib
+
+#Stage-out of the files a job produces, started before the production so transfers overlap with the later steps.
+#Files are taken from the command line, or from a queue file that gensimToNTuple.sh appends to, one request per line:
+#    copy <path>      the file is complete, transfer it if it matches --include
+#    release <path>   no later step reads the file, with --remove it is deleted once its transfer succeeded
+#    done             no more requests, wait for the transfers and exit
+#Transfers run in parallel, are verified with adler32 and retried with exponential backoff.
+#The destination is an xrootd url (root://...) or a local directory, which stands in for EOS when testing.
+#Exit status: 0 every transfer succeeded, 1 some transfer failed after all retries, 2 bad arguments or queue.
+
+def adler32(fileName):
+    value = 1
+    with open(fileName,"rb") as f:
+        while True:
+            block = f.read(4*1024*1024)
+            if not block:
+                break
+            value = zlib.adler32(block,value)
+    return "{0:08x}".format(value & 0xffffffff)
+
+def splitUrl(url):
+    #root://host//path -> (root://host, /path)
+    rest = url[len("root://"):]
+    host,path = rest.split("/",1)
+    return "root://"+host,"/"+path.lstrip("/")
+
+class Destination(object):
+    def __init__(self,destination):
+        self.remote = destination.startswith("root://")
+        self.destination = destination.rstrip("/")
+
+    def target(self,fileName):
+        return self.destination+"/"+os.path.basename(fileName)
+
+    def copy(self,fileName):
+        target = self.target(fileName)
+        if self.remote:
+            if subprocess.call(["xrdcp","-f","-s","-p",fileName,target]) != 0:
+                raise IOError("xrdcp to {0} failed".format(target))
+        else:
+            #Written under a temporary name so a failed copy never looks complete
+            partial = os.path.join(self.destination,"."+os.path.basename(fileName)+".part")
+            shutil.copyfile(fileName,partial)
+            os.rename(partial,target)
+
+    def checksum(self,fileName):
+        target = self.target(fileName)
+        if not self.remote:
+            return adler32(target)
+        host,path = splitUrl(target)
+        output = subprocess.check_output(["xrdfs",host,"query","checksum",path]).decode("ascii").split()
+        if len(output) < 2 or output[0] != "adler32":
+            raise IOError("unexpected checksum reply for {0}: {1}".format(target," ".join(output)))
+        return output[1].lower().zfill(8)
+
+class StageOut(object):
+    def __init__(self,args):
+        self.destination = Destination(args.destination)
+        self.includes = args.include
+        self.retries = args.retries
+        self.backoff = args.backoff
+        self.remove = args.remove
+        self.slots = threading.Semaphore(args.jobs)
+        self.lock = threading.Lock()
+        self.threads = []
+        self.copied = set()
+        self.released = set()
+        self.requested = set()
+        self.failed = []
+
+    def selected(self,fileName):
+        return not self.includes or any(fnmatch.fnmatch(os.path.basename(fileName),p) for p in self.includes)
+
+    def copy(self,fileName):
+        if fileName in self.requested:
+            return
+        if not self.selected(fileName):
+            print("stageOut: skipping {0}".format(fileName))
+            self.markCopied(fileName)
+            return
+        self.requested.add(fileName)
+        thread = threading.Thread(target=self.transfer,args=(fileName,))
+        thread.start()
+        self.threads.append(thread)
+
+    def release(self,fileName):
+        with self.lock:
+            self.released.add(fileName)
+            ready = fileName in self.copied
+        if ready:
+            self.removeLocal(fileName)
+
+    def markCopied(self,fileName):
+        with self.lock:
+            self.copied.add(fileName)
+            ready = fileName in self.released
+        if ready:
+            self.removeLocal(fileName)
+
+    def removeLocal(self,fileName):
+        if self.remove and os.path.exists(fileName):
+            os.remove(fileName)
+            print("stageOut: removed local {0}".format(fileName))
+
+    def transfer(self,fileName):
+        with self.slots:
+            for attempt in range(self.retries+1):
+                if attempt > 0:
+                    wait = self.backoff*2**(attempt-1)
+                    print("stageOut: retrying {0} in {1:g} s".format(fileName,wait))
+                    time.sleep(wait)
+                try:
+                    start = time.time()
+                    local = adler32(fileName)
+                    self.destination.copy(fileName)
+                    remote = self.destination.checksum(fileName)
+                    if remote != local:
+                        raise IOError("adler32 mismatch for {0}: local {1}, destination {2}".format(fileName,local,remote))
+                    print("stageOut: copied {0} to {1} in {2:.1f} s, adler32 {3}".format(fileName,self.destination.target(fileName),time.time()-start,local))
+                    self.markCopied(fileName)
+                    return
+                except (IOError,OSError,subprocess.CalledProcessError) as error:
+                    print("stageOut: attempt {0} of {1} failed: {2}".format(attempt+1,fileName,error))
+        with self.lock:
+            self.failed.append(fileName)
+
+    def follow(self,queueName,poll):
+        #Reads complete lines as they are appended until "done"
+        offset = 0
+        pending = ""
+        while True:
+            with open(queueName) as queue:
+                queue.seek(offset)
+                chunk = queue.read()
+                offset = queue.tell()
+            pending += chunk
+            lines = pending.split("\n")
+            pending = lines.pop()
+            for line in lines:
+                words = line.split()
+                if not words:
+                    continue
+                if words[0] == "done":
+                    return True
+                if len(words) != 2 or words[0] not in ["copy","release"]:
+                    print("stageOut: invalid queue line '{0}'".format(line))
+                    return False
+                if words[0] == "copy":
+                    self.copy(words[1])
+                else:
+                    self.release(words[1])
+            if not chunk:
+                time.sleep(poll)
+
+    def wait(self):
+        for thread in self.threads:
+            thread.join()
+        for fileName in self.failed:
+            print("stageOut: FAILED {0}".format(fileName))
+        return 1 if self.failed else 0
+
+if __name__=='__main__':
+    parser = argparse.ArgumentParser()
+    parser.add_argument("destination",type=str,help="root://host//path or a local directory")
+    parser.add_argument("files",type=str,nargs="*",help="files to transfer right away")
+    parser.add_argument("-q","--queue",type=str,default=None,help="queue file to follow for copy/release requests until 'done'")
+    parser.add_argument("-i","--include",type=str,action="append",default=[],help="file name pattern to transfer, repeatable, everything by default")
+    parser.add_argument("-j","--jobs",type=int,default=4,help="parallel transfers")
+    parser.add_argument("-r","--retries",type=int,default=3,help="retries of a failed transfer")
+    parser.add_argument("-b","--backoff",type=float,default=10.,help="seconds before the first retry, doubled for every further one")
+    parser.add_argument("--remove",action="store_true",help="delete local files once transferred and released, files given on the command line count as released")
+    parser.add_argument("--poll",type=float,default=1.,help="seconds between reads of the queue file")
+    args = parser.parse_args()
+
+    if args.jobs < 1 or args.retries < 0:
+        print("stageOut: need at least one parallel transfer and no negative retries")
+        sys.exit(2)
+    if not args.destination.startswith("root://") and not os.path.isdir(args.destination):
+        print("stageOut: destination directory {0} does not exist".format(args.destination))
+        sys.exit(2)
+
+    stageOut = StageOut(args)
+    for fileName in args.files:
+        stageOut.release(fileName)
+        stageOut.copy(fileName)
+
+    queueOk = True
+    if args.queue is not None:
+        queueOk = stageOut.follow(args.queue,args.poll)
+    status = stageOut.wait()
+    sys.exit(status if queueOk else 2)
@@ -3,17 +3,100 @@ import os
 import argparse
 import subprocess
 import glob
+import json
+import math
 from datetime import date
-from random import randint
+from random import sample
 
 parser = argparse.ArgumentParser()
 
+def readFilterEfficiencies(pattern):
+    #Combine the GEN-SIM reports of earlier productions into one filter efficiency per mass, weighted by generated events
+    generated = {}
+    accepted  = {}
+    for report in glob.glob(pattern):
+        with open(report) as f:
+            summary = json.load(f)
+        mass = str(summary["mass"])
+        generated[mass] = generated.get(mass,0) + summary["generatedEvents"]
+        accepted[mass]  = accepted.get(mass,0) + summary["acceptedEvents"]
+    return {mass : float(accepted[mass])/generated[mass] for mass in generated if generated[mass] > 0}
+
+#Columns of the argument table, in the order of the runGenerator.sh arguments followed by the job resources
+jobColumns = ["mass","events","eos","jobNum","genseed","g4seed","vtxseed","threads","streams","memory"]
+
+def validateJobs(jobs):
+    #Checks the whole table before anything reaches the schedd, returns a list of problems
+    problems = []
+    names = set()
+    seeds = set()
+    for job in jobs:
+        row = dict(zip(jobColumns,job))
+        for key in jobColumns:
+            value = str(row[key])
+            if not value or any(c.isspace() or c == "," for c in value):
+                problems.append("job {0} of M = {1}: empty or separator in {2} '{3}'".format(row["jobNum"],row["mass"],key,value))
+        for key,minimum in [("mass",1),("events",1),("jobNum",0),("genseed",1),("g4seed",1),("vtxseed",1),("threads",1),("streams",0),("memory",1)]:
+            if not str(row[key]).isdigit() or int(row[key]) < minimum:
+                problems.append("job {0} of M = {1}: {2} must be an integer of at least {3}, got '{4}'".format(row["jobNum"],row["mass"],key,minimum,row[key]))
+        #Output files are named after the mass and job number, a repeat would overwrite them on eos
+        name = (str(row["mass"]),str(row["jobNum"]))
+        if name in names:
+            problems.append("job {0} of M = {1} appears twice".format(row["jobNum"],row["mass"]))
+        names.add(name)
+        seed = (str(row["mass"]),row["genseed"],row["g4seed"],row["vtxseed"])
+        if seed in seeds:
+            problems.append("job {0} of M = {1} repeats the seeds of another job".format(row["jobNum"],row["mass"]))
+        seeds.add(seed)
+    return problems
+
+def costForMass(model,mass):
+    #Cost of a mass from the model of buildCostModel.py, linearly interpolated in mass between measured points
+    masses = sorted(model["masses"],key=int)
+    if not masses:
+        return None
+    if mass in model["masses"]:
+        return model["masses"][mass]
+    below = [m for m in masses if int(m) < int(mass)]
+    above = [m for m in masses if int(m) > int(mass)]
+    if not below:
+        return model["masses"][above[0]]
+    if not above:
+        return model["masses"][below[-1]]
+    low,high = model["masses"][below[-1]],model["masses"][above[0]]
+    frac = float(int(mass) - int(below[-1]))/(int(above[0]) - int(below[-1]))
+    cost = {}
+    for key in ["secondsPerEvent","overheadSeconds"]:
+        cost[key] = low[key] + frac*(high[key] - low[key])
+    memories = [c["peakMemoryMB"] for c in [low,high] if c["peakMemoryMB"] is not None]
+    cost["peakMemoryMB"] = max(memories) if memories else None
+    return cost
+
+def splitEvents(total,perjob):
+    #Fewest jobs of at most perjob events, sized evenly so no job runs much longer than the others
+    njobs = max(1,int(math.ceil(float(total)/perjob)))
+    return [total//njobs + (1 if x < total % njobs else 0) for x in range(njobs)]
+
 if __name__=='__main__':
     parser.add_argument("-f","--samplecsv",type=str,help=".csv with hscp mass point and number of events")
     parser.add_argument("-k","--killsubmission",type=bool,default=False,help="removes jdl creation and job submission, meant for printing a command to pass for interactive running")
-    parser.add_argument("-n","--maxevents",type=int,default=False,help="max events per job")
+    parser.add_argument("-d","--dryrun",action="store_true",help="builds and validates the job table and jdl without creating eos directories or submitting")
+    parser.add_argument("-n","--maxevents",type=int,default=None,help="max events per job, an upper bound of the cost model sizing with -c")
+    parser.add_argument("-t","--threads",type=int,default=1,help="threads per job, also the number of requested cpus")
+    parser.add_argument("-s","--streams",type=int,default=0,help="concurrent events per job, 0 means one per thread")
+    parser.add_argument("-m","--memory",type=int,default=4000,help="requested memory per job in MB, each extra stream holds its own event in memory")
+    parser.add_argument("-a","--accepted",action="store_true",help="event counts of the .csv and -n are events passing the R-hadron pair filter, the generated events are scaled by the filter efficiency")
+    parser.add_argument("-c","--costmodel",type=str,default=None,help="cost model .json of buildCostModel.py, sizes the events and memory of each job per mass")
+    parser.add_argument("-e","--checkpoint",type=int,default=0,help="events per checkpoint block of the GEN-SIM step, an evicted job resumes after the last complete block, needs a single stream")
+    parser.add_argument("-w","--walltime",type=float,default=4.0,help="with -c, target wall time per job in hours")
+    parser.add_argument("-r","--reports",type=str,default=None,help="glob of GEN-SIM report .json files to take the filter efficiency per mass from, overridden by a third .csv column")
     args = parser.parse_args()
 
+    #Checkpoint blocks continue the random engines of one stream
+    if args.checkpoint < 0 or (args.checkpoint > 0 and (args.streams or args.threads) != 1):
+        print("Checkpoints need a positive block size and a single stream, use -s 1 with several threads")
+        sys.exit(1)
+
     #check that there is a max per job
     maxperjob = args.maxevents
     if (maxperjob is None):
@@ -32,19 +115,14 @@ if __name__=='__main__':
     if not os.path.exists("condorMonitoringOutput/"+str(date.today())+"/"):
         os.makedirs("condorMonitoringOutput/"+str(date.today())+"/")
 
-    #Check that there is no random crap being transfered
-    if os.path.exists("../SpikedRHadronAnalyzer/data"):
-        print("DATA DIRECTORY FOUND BEFORE MAKING TARBALL -- MIGHT HAVE THINGS TO BREAK")
-        print("exiting, make sure to remove spurious files")
-        sys.exit()
-        
-    #Tar the working area
-    print("Creating tarball of working area")
-    tarballName = "cmsswTar.tar.gz"
-    if not os.path.exists(tarballName):
-        os.system("tar -hcf "+tarballName+" ../../../../CMSSW_10_6_47")
-    else:
-        print('FOUND A TARBALL -- USING, BE CAREFULL!!!!!')
+    #Package the compiled libraries and scripts, an unchanged build gives the same content-hashed package
+    print("Creating slim software package")
+    try:
+        tarballName = subprocess.check_output("./makeSlimPackage.sh",shell=True).decode(sys.stdout.encoding).split()[-1]
+    except subprocess.CalledProcessError:
+        print("makeSlimPackage.sh failed, nothing submitted")
+        sys.exit(1)
+    print("Jobs use {0}".format(tarballName))
 
     #Where do you want to save it
     eosForOutput = "root://cmseos.fnal.gov//store/user/lpchscp/gcumming/signalv3_prod_"+str(date.today())
@@ -52,7 +130,9 @@ if __name__=='__main__':
     eosFinalDir  = eosOnlypath.split("/")[-1]
 
     #check eos for premade directories
-    if os.system("eos root://cmseos.fnal.gov/ ls /store/user/lpchscp/ | grep signalv3_prod_") == 0:#if there are eos directories
+    if args.dryrun:
+        print("Dry run, not creating the EOS output directory")
+    elif os.system("eos root://cmseos.fnal.gov/ ls /store/user/lpchscp/ | grep signalv3_prod_") == 0:#if there are eos directories
         eos_conflict_dirs = subprocess.check_output("eos root://cmseos.fnal.gov/ ls /store/user/lpchscp/ | grep signalv3_prod_",shell=True).decode(sys.stdout.encoding).split()
         if not any(eosFinalDir in path for path in eos_conflict_dirs): 
             print("Desired EOS output directory does not exist - creating it!")
@@ -65,70 +145,140 @@ if __name__=='__main__':
 
     
     #Submit the jobs
-    jobcnt = 0
+    jobs = []
     print("Root files are written to {0}".format(eosOnlypath))
 
     #Read in a sample .csv with the samples and event counts you want to make
     configf = open(args.samplecsv,"r")
     configs = configf.readlines()
-    confs = [x.split(',') for x in configs]
+    confs = [x.split(',') for x in configs if x.strip()]
+
+    costmodel = None
+    if args.costmodel is not None:
+        with open(args.costmodel) as f:
+            costmodel = json.load(f)
+        if costmodel["threads"] != args.threads:
+            print("WARNING: the cost model was measured with {0} threads, the jobs run {1}".format(costmodel["threads"],args.threads))
+
+    efficiencies = {}
+    if args.reports is not None:
+        efficiencies = readFilterEfficiencies(args.reports)
+        for mass in sorted(efficiencies):
+            print("Filter efficiency of M = {0} from reports: {1:.4f}".format(mass,efficiencies[mass]))
 
     for conf in confs:
+        conf = [x.strip() for x in conf]
         print("Building jobs to generate R-Hadrion signal of M = ",conf[0])
         print("    total number of desired events: ",conf[1])
 
-        eventlist = []
-        njobs = 0
-        if int(conf[1]) > maxperjob:
-            njobsatmax = int(conf[1]) // maxperjob
-            nremain    = int(conf[1]) % maxperjob
-            eventlist = [maxperjob for x in range(njobsatmax)]
-            if nremain > 0:
-                eventlist.append(nremain)
+        #Jobs are split by accepted events, each job generates enough events to accept its share on average
+        efficiency = 1.0
+        if args.accepted:
+            if len(conf) > 2 and conf[2]:
+                efficiency = float(conf[2])
+            elif conf[0] in efficiencies:
+                efficiency = efficiencies[conf[0]]
+            else:
+                print("    WARNING: no filter efficiency known for M = {0}, assuming every event is accepted".format(conf[0]))
+                efficiency = 1.0
+            if efficiency <= 0 or efficiency > 1:
+                print("Invalid filter efficiency {0} for M = {1}".format(efficiency,conf[0]))
+                sys.exit()
+            print("           filter efficiency used: ",efficiency)
+
+        cost = costForMass(costmodel,conf[0]) if costmodel is not None else None
+        memory = args.memory
+        if cost is not None:
+            #The model counts generated events, its event budget is balanced over the fewest jobs that fit in the wall time
+            generated = int(math.ceil(int(conf[1])/efficiency))
+            perjob = int((args.walltime*3600 - cost["overheadSeconds"])/cost["secondsPerEvent"])
+            if args.maxevents:
+                perjob = min(perjob,int(math.ceil(maxperjob/efficiency)))
+            if perjob < 1:
+                print("    WARNING: a single event of M = {0} is expected to exceed the wall time, one event per job".format(conf[0]))
+                perjob = 1
+            eventlist = splitEvents(generated,perjob)
+            print("    expected wall time per job [h]: {0:.2f}".format((cost["overheadSeconds"] + eventlist[0]*cost["secondsPerEvent"])/3600))
+            if cost["peakMemoryMB"] is not None:
+                #25% above the largest peak seen, rounded up to 250 MB
+                memory = max(2000,int(math.ceil(1.25*cost["peakMemoryMB"]/250.0))*250)
+            print("          requested memory [MB]: ",memory)
         else:
-            eventlist.append(int(conf[1]))
+            if costmodel is not None:
+                print("    WARNING: no cost known for M = {0}, using fixed chunks".format(conf[0]))
+            eventlist = []
+            njobs = 0
+            if int(conf[1]) > maxperjob:
+                njobsatmax = int(conf[1]) // maxperjob
+                nremain    = int(conf[1]) % maxperjob
+                eventlist = [maxperjob for x in range(njobsatmax)]
+                if nremain > 0:
+                    eventlist.append(nremain)
+            else:
+                eventlist.append(int(conf[1]))
+            eventlist = [int(math.ceil(x/efficiency)) for x in eventlist]
 
         print("              Total number of jobs: ",len(eventlist))
 
-        #build the random seeds to generate different events
-        genseeds = [randint(100000000,999999999) for r in range(len(eventlist))]
-        g4seeds  = [randint(10000,99999) for r in range(len(eventlist))]
-        vtxseeds = [randint(100000,999999) for r in range(len(eventlist))]
+        #build the random seeds to generate different events, distinct within a mass so no two jobs repeat events
+        genseeds = sample(range(100000000,1000000000),len(eventlist))
+        g4seeds  = sample(range(10000,100000),len(eventlist))
+        vtxseeds = sample(range(100000,1000000),len(eventlist))
 
         #do loop through the event list which builds the jobs
-        it = 0
         for j,job in enumerate(eventlist):
-            print("            Building Job {} for {} events.".format(it,job))
-            
-            #Args to pass
-            argu = "Arguments = {0} {1} {2} {3} {4} {5} {6}".format(conf[0],job,eosForOutput,it,genseeds[j],g4seeds[j],vtxseeds[j])
-            
-            if not args.killsubmission:
-                #Make the jdl for each sample
-                jdlName = "production_M"+conf[0]+"_"+str(date.today())+".jdl"
-                jdl = open(jdlName,"w")
-                jdl.write("universe = vanilla\n")
-                jdl.write("request_memory=4000\n")
-                jdl.write("Should_Transfer_Files = YES\n")
-                jdl.write("WhenToTransferOutput = ON_EXIT\n")
-                jdl.write("Transfer_Input_Files = "+tarballName+"\n")
-                jdl.write("Output = condorMonitoringOutput/{0}/{1}_job{2}_Events{3}_stdout.stdout\n".format(str(date.today()),"production_M"+conf[0],str(it),job))
-                jdl.write("Error = condorMonitoringOutput/{0}/{1}_job{2}_Events{3}_err.stder\n".format(str(date.today()),"production_M"+conf[0],str(it),job))
-                jdl.write("Log = condorMonitoringOutput/{0}/{1}_job{2}_Events{3}_log.log\n".format(str(date.today()),"production_M"+conf[0],str(it),job))
-                jdl.write("Executable = runGenerator.sh\n")
-                jdl.write(argu)
-                #jdl.write('+DESIRED_Sites="T3_US_Baylor,T2_US_Caltech,T3_US_Colorado,T3_US_Cornell,T3_US_FIT,T3_US_FNALLPC,T3_US_Omaha,T3_US_JHU,T3_US_Kansas,T2_US_MIT,T3_US_NotreDame,T2_US_Nebraska,T3_US_NU,T3_US_OSU,T3_US_Princeton_ICSE,T2_US_Purdue,T3_US_Rice,T3_US_Rutgers,T3_US_MIT,T3_US_NERSC,T3_US_SDSC,T3_US_FIU,T3_US_FSU,T3_US_OSG,T3_US_TAMU,T3_US_TTU,T3_US_UCD,T3_US_UCSB,T2_US_UCSD,T3_US_UMD,T3_US_UMiss,T2_US_Vanderbilt,T2_US_Wisconsin"')
-                jdl.write("\n")
-                jdl.write('+ApptainerImage = "/cvmfs/singularity.opensciencegrid.org/cmssw/cms:rhel7"')
-                jdl.write("\n")
-                jdl.write("Queue 1\n")#Not sure about this one
-                jdl.close()
-                
-                #submit the jobs
-                os.system("condor_submit {0}".format(jdlName))
+            print("            Building Job {} for {} events.".format(j,job))
+            jobs.append([conf[0],job,eosForOutput,j,genseeds[j],g4seeds[j],vtxseeds[j],args.threads,args.streams,memory])
 
-            else:
-                print("Not submitting jobs, printing passed arguments")
-                print(argu)
-            it+=1
-    print("Submitted {} jobs".format(it))
+    problems = validateJobs(jobs)
+    for problem in problems:
+        print("INVALID JOB TABLE: "+problem)
+    if problems:
+        sys.exit(1)
+
+    if args.killsubmission:
+        print("Not submitting jobs, printing passed arguments")
+        for job in jobs:
+            print("Arguments = "+" ".join(str(x) for x in job[:9])+" {0} {1}".format(tarballName,args.checkpoint))
+        sys.exit()
+
+    #One argument table and one jdl per production, the table is also the manifest of every job's seeds
+    version = 0
+    while os.path.exists("production_{0}_v{1}_jobs.txt".format(date.today(),version)):
+        version += 1
+    productionName = "production_{0}_v{1}".format(date.today(),version)
+    tableName = productionName+"_jobs.txt"
+    with open(tableName,"w") as table:
+        for job in jobs:
+            table.write(" ".join(str(x) for x in job)+"\n")
+
+    logName = "condorMonitoringOutput/{0}/production_M$(mass)_job$(jobNum)_Events$(events)".format(str(date.today()))
+    jdlName = productionName+".jdl"
+    jdl = open(jdlName,"w")
+    jdl.write("universe = vanilla\n")
+    jdl.write("request_memory=$(memory)\n")
+    jdl.write("request_cpus=$(threads)\n")
+    jdl.write("Should_Transfer_Files = YES\n")
+    jdl.write("WhenToTransferOutput = ON_EXIT\n")
+    jdl.write("Transfer_Input_Files = "+tarballName+"\n")
+    jdl.write("Output = "+logName+"_stdout.stdout\n")
+    jdl.write("Error = "+logName+"_err.stder\n")
+    jdl.write("Log = "+logName+"_log.log\n")
+    jdl.write("Executable = runGenerator.sh\n")
+    jdl.write("Arguments = $(mass) $(events) $(eos) $(jobNum) $(genseed) $(g4seed) $(vtxseed) $(threads) $(streams) {0} {1}\n".format(tarballName,args.checkpoint))
+    #jdl.write('+DESIRED_Sites="T3_US_Baylor,T2_US_Caltech,T3_US_Colorado,T3_US_Cornell,T3_US_FIT,T3_US_FNALLPC,T3_US_Omaha,T3_US_JHU,T3_US_Kansas,T2_US_MIT,T3_US_NotreDame,T2_US_Nebraska,T3_US_NU,T3_US_OSU,T3_US_Princeton_ICSE,T2_US_Purdue,T3_US_Rice,T3_US_Rutgers,T3_US_MIT,T3_US_NERSC,T3_US_SDSC,T3_US_FIU,T3_US_FSU,T3_US_OSG,T3_US_TAMU,T3_US_TTU,T3_US_UCD,T3_US_UCSB,T2_US_UCSD,T3_US_UMD,T3_US_UMiss,T2_US_Vanderbilt,T2_US_Wisconsin"')
+    jdl.write('+ApptainerImage = "/cvmfs/singularity.opensciencegrid.org/cmssw/cms:rhel7"')
+    jdl.write("\n")
+    jdl.write("Queue "+",".join(jobColumns)+" from "+tableName+"\n")
+    jdl.close()
+    print("Job table written to {0}, jdl to {1}".format(tableName,jdlName))
+
+    if args.dryrun:
+        print("Dry run, {} valid jobs not submitted".format(len(jobs)))
+        sys.exit()
+
+    #submit every job of the production in one call
+    if os.system("condor_submit {0}".format(jdlName)) != 0:
+        print("condor_submit failed, nothing was submitted from {0}".format(jdlName))
+        sys.exit(1)
+    print("Submitted {} jobs".format(len(jobs)))
@@ -16,11 +16,117 @@ seeded=True
 genseed=$4
 g4seed=$5
 vtxseed=$6
+threads=${7:-1} # Number of threads of the cmsRun processes
+streams=${8:-0} # Number of concurrent events of the cmsRun processes, 0 means one per thread
 eventdisplay=false # Set to true to create CSVs of the R-Hadron energy deposits during simulation for the purpose of an event display
 ntuple=false # Set to true to run the NTuplizer over the RECO file
+fused=false # Set to true to run GEN-SIM through RECO in one cmsRun process instead of four, without intermediate files
+keepRaw=false # With fused=true, set to true to also keep the GEN-SIM-RAW file after HLT
+checkpointEvents=${9:-0} # Events per checkpoint block of the GEN-SIM (or fused) step, 0 runs it in one go
 
 # -------------------------------------
 
+# Hands files to the stage-out started by runGenerator.sh, if any: "copy" once a file is complete,
+# "release" once no later step reads it, so it can leave the local disk
+stageOut() {
+    if [ -n "$STAGEOUT_QUEUE" ] && [ -f "$2" ]; then
+        echo "$1 $PWD/$2" >> $STAGEOUT_QUEUE
+    fi
+}
+
+# Stops the job when a step fails: $1 names the step, $2 is its exit code, the other arguments are its outputs.
+# The partial outputs are removed, so neither the stage-out nor a rerun takes them for finished files, and the
+# inputs of the step are not released, so --remove never deletes them.
+fail() {
+    echo "$1 failed with exit code $2"
+    shift 2
+    rm -f "$@"
+    exit 1
+}
+
+# Event-level checkpoints. With checkpointEvents > 0 the GEN-SIM (or fused) step runs as one cmsRun per block of
+# checkpointEvents events, each starting from the random engine states saved at the end of the previous block,
+# and the blocks are merged into the usual output file. The blocks do not depend on where a job was interrupted.
+# A block is complete once its .done file lists the job's seeds and the adler32 of its files. A restarted job with
+# data/checkpoint restored (runGenerator.sh mirrors it to eos) resumes after the last complete block.
+checkpointOut() {
+    if [ -n "$CHECKPOINT_QUEUE" ]; then
+        echo "copy $PWD/$1" >> $CHECKPOINT_QUEUE
+    fi
+}
+
+adler32() {
+    python -c "
+import sys,zlib
+value = 1
+with open(sys.argv[1],'rb') as f:
+    for block in iter(lambda: f.read(1 << 22), b''):
+        value = zlib.adler32(block,value)
+print('%08x' % (value & 0xffffffff))" $1
+}
+
+blockComplete() {
+    [ -f data/checkpoint/$1.done ] || return 1
+    [ "$(head -1 data/checkpoint/$1.done)" == "$blockKey" ] || return 1
+    tail -n +2 data/checkpoint/$1.done | while read sum file; do
+        [ -f data/checkpoint/$file ] && [ "$(adler32 data/checkpoint/$file)" == "$sum" ] || exit 1
+    done
+}
+
+runBlocks() {
+    # $1 file the blocks are merged into, $2 file the GEN-SIM-RAW blocks of the fused step are merged into (or ""),
+    # the other arguments are passed to every cmsRun
+    local merged=$1 mergedRaw=$2
+    shift 2
+    blockKey="seeds $genseed $g4seed $vtxseed events $events checkpointEvents $checkpointEvents fused $fused keepRaw $keepRaw"
+    mkdir -p data/checkpoint
+    local nBlocks=$(( (events + checkpointEvents - 1) / checkpointEvents ))
+    local inputs="" rawInputs=""
+    for (( block=0; block<nBlocks; block++ )); do
+        local name=${dir_name}_block$block
+        local first=$(( block*checkpointEvents + 1 ))
+        local blockEvents=$(( events - block*checkpointEvents ))
+        if [ $blockEvents -gt $checkpointEvents ]; then
+            blockEvents=$checkpointEvents
+        fi
+        local files="$name.root ${name}_rng.txt ${name}_genSimReport.json"
+        local options=""
+        if [ -n "$mergedRaw" ]; then
+            files="$files ${name}_raw.root"
+            options="rawOutputFile=data/checkpoint/${name}_raw.root"
+        fi
+        if blockComplete $name; then
+            echo "Block $block complete, skipping events $first to $(( first + blockEvents - 1 ))"
+        else
+            echo "Starting block $block: events $first to $(( first + blockEvents - 1 ))"
+            if [ $block -gt 0 ]; then
+                options="$options restoreRandomState=data/checkpoint/${dir_name}_block$(( block - 1 ))_rng.txt"
+            fi
+            cmsRun EXO-RunIISummer20UL18GENSIM-00010_1_cfg_v3.py maxEvents=$blockEvents firstEvent=$first eventsPerLumi=$checkpointEvents saveRandomState=${name}_rng.txt outputFile=data/checkpoint/$name.root reportFile=data/checkpoint/${name}_genSimReport.json $options "$@" || return 1
+            mv ${name}_rng.txt data/checkpoint/
+            { echo "$blockKey"; for file in $files; do echo "$(adler32 data/checkpoint/$file) $file"; done; } > data/checkpoint/$name.tmp
+            mv data/checkpoint/$name.tmp data/checkpoint/$name.done
+            for file in $files $name.done; do
+                checkpointOut data/checkpoint/$file
+            done
+        fi
+        inputs="$inputs,file:data/checkpoint/$name.root"
+        rawInputs="$rawInputs,file:data/checkpoint/${name}_raw.root"
+    done
+
+    # merged under a temporary name, an interrupted merge must not look like a finished step
+    echo "Merging $nBlocks blocks into $merged"
+    if [ -n "$mergedRaw" ]; then
+        cmsRun python/mergeBlocks_cfg.py inputFiles=${rawInputs#,} outputFile=${mergedRaw%.root}_merging.root || return 1
+        mv ${mergedRaw%.root}_merging.root $mergedRaw
+    fi
+    cmsRun python/mergeBlocks_cfg.py inputFiles=${inputs#,} outputFile=${merged%.root}_merging.root || return 1
+    mv ${merged%.root}_merging.root $merged
+    for (( block=0; block<nBlocks; block++ )); do
+        stageOut copy data/checkpoint/${dir_name}_block${block}_genSimReport.json
+    done
+}
+
 # cd into correct directory
 cd SpikedRHadronAnalyzer
 
@@ -55,19 +161,71 @@ hltOut=$dir_name"_hltM"$mass"_"$events"Events.out"
 recoRoot=$dir_name"_recoM"$mass"_"$events"Events.root"
 recoOut=$dir_name"_recoM"$mass"_"$events"Events.out"
 
+# ntuple of the RECO file
+ntupleRoot=$dir_name"_ntupleM"$mass"_"$events"Events.root"
+
+# end-of-job filter efficiency and timing report of the GEN-SIM step
+genSimReport=$dir_name"_genSimReportM"$mass"_"$events"Events.json"
+
+genProcess=SIM
+if $fused; then
+
+if [ ! -f data/$recoRoot ]; then
+    echo "Starting fused GEN-SIM to RECO"
+    rawOption=""
+    if $keepRaw; then
+        rawOption="rawOutputFile=data/$hltRoot"
+    fi
+    if [ $checkpointEvents -gt 0 ]; then
+        rawMerged=""
+        if $keepRaw; then
+            rawMerged=data/$hltRoot
+        fi
+        runBlocks data/$recoRoot "$rawMerged" seeded=$seeded mass=$mass cmEnergy=$cmEnergy genseed=$genseed g4seed=$g4seed vtxseed=$vtxseed fused=True numberOfThreads=$threads numberOfStreams=$streams >& data/$recoOut || fail "Fused GEN-SIM to RECO" $? data/$recoRoot data/$hltRoot
+    else
+        cmsRun EXO-RunIISummer20UL18GENSIM-00010_1_cfg_v3.py maxEvents=$events seeded=$seeded mass=$mass cmEnergy=$cmEnergy outputFile=data/$recoRoot genseed=$genseed g4seed=$g4seed vtxseed=$vtxseed reportFile=data/$genSimReport fused=True numberOfThreads=$threads numberOfStreams=$streams $rawOption >& data/$recoOut || fail "Fused GEN-SIM to RECO" $? data/$recoRoot data/$hltRoot data/$genSimReport
+    fi
+    echo "Fused GEN-SIM to RECO completed"
+    stageOut copy data/$recoRoot
+    stageOut copy data/$genSimReport
+    stageOut release data/$genSimReport
+    if $keepRaw; then
+        stageOut copy data/$hltRoot
+        stageOut release data/$hltRoot
+    fi
+else
+    echo "reco file found printing contents"
+    ls -lh data
+fi
+
+# The RECO file keeps the GEN particles and SimHits, the event display reads it instead of a GEN-SIM file.
+# The fused process is named HLT, so the gen particles carry that process name.
+genSimRoot=$recoRoot
+genProcess=HLT
+
+else
+
 if [ ! -f data/$genSimRoot ]; then
     echo "Starting step 0: GEN-SIM"
-    cmsRun EXO-RunIISummer20UL18GENSIM-00010_1_cfg_v3.py maxEvents=$events seeded=$seeded mass=$mass cmEnergy=$cmEnergy outputFile=data/$genSimRoot genseed=$genseed g4seed=$g4seed vtxseed=$vtxseed
+    if [ $checkpointEvents -gt 0 ]; then
+        runBlocks data/$genSimRoot "" seeded=$seeded mass=$mass cmEnergy=$cmEnergy genseed=$genseed g4seed=$g4seed vtxseed=$vtxseed numberOfThreads=$threads numberOfStreams=$streams || fail "Step 0: GEN-SIM" $? data/$genSimRoot
+    else
+        cmsRun EXO-RunIISummer20UL18GENSIM-00010_1_cfg_v3.py maxEvents=$events seeded=$seeded mass=$mass cmEnergy=$cmEnergy outputFile=data/$genSimRoot genseed=$genseed g4seed=$g4seed vtxseed=$vtxseed reportFile=data/$genSimReport numberOfThreads=$threads numberOfStreams=$streams || fail "Step 0: GEN-SIM" $? data/$genSimRoot data/$genSimReport
+    fi
     echo "Step 0 completed"
+    stageOut copy data/$genSimRoot
+    stageOut copy data/$genSimReport
+    stageOut release data/$genSimReport
 else
     echo "Gensim file found printing contents"
     ls -lh data
 fi
 
 
+# cmsDriver.py only writes the configs of the later steps, they are run with cmsRun so that their exit codes are checked
 if [ ! -f data/$digiRawRoot ]; then
     echo "Starting step 1: DIGI-L1-DIGI2RAW"
-    cmsDriver.py --filein file:data/$genSimRoot \
+    { cmsDriver.py --filein file:data/$genSimRoot \
         --fileout file:data/$digiRawRoot\
         --mc \
         --eventcontent RAWSIM \
@@ -77,8 +235,15 @@ if [ ! -f data/$digiRawRoot ]; then
         --python_filename data/step1_cfg.py \
         --geometry DB:Extended \
         --era Run2_2018 \
-        -n -1 >& data/$digiRawOut
+        --nThreads $threads \
+        --nStreams $streams \
+        --no_exec \
+        -n -1 && cmsRun data/step1_cfg.py; } >& data/$digiRawOut || fail "Step 1: DIGI-L1-DIGI2RAW" $? data/$digiRawRoot
     echo "Step 1 completed"
+    stageOut copy data/$digiRawRoot
+    if ! $eventdisplay; then
+        stageOut release data/$genSimRoot
+    fi
 else
     echo "digi file found file found printing contents"
     ls -lh data
@@ -88,19 +253,24 @@ fi
 
 if [ ! -f data/$hltRoot ]; then
     echo "Starting step 2: RAW2DIGI-L1Reco-RECO"
-    cmsDriver.py --filein file:data/$digiRawRoot \
+    { cmsDriver.py --filein file:data/$digiRawRoot \
         --fileout file:data/$hltRoot \
         --mc \
         --eventcontent RAWSIM \
         --datatier GEN-SIM-RAW \
         --conditions 106X_upgrade2018_realistic_v4 \
         --step HLT:GRun \
-        --python_filename data/$stepHLT_cfg.py \
+        --python_filename data/stepHLT_cfg.py \
         --geometry DB:Extended \
         --era Run2_2018 \
-        -n -1 >& data/$hltOut
+        --nThreads $threads \
+        --nStreams $streams \
+        --no_exec \
+        -n -1 && cmsRun data/stepHLT_cfg.py; } >& data/$hltOut || fail "Step 2: HLT" $? data/$hltRoot
+    stageOut copy data/$hltRoot
+    stageOut release data/$digiRawRoot
 
-    cmsDriver.py --filein file:data/$hltRoot \
+    { cmsDriver.py --filein file:data/$hltRoot \
         --fileout file:data/$recoRoot \
         --mc \
         --eventcontent FEVTDEBUGHLT \
@@ -110,19 +280,26 @@ if [ ! -f data/$hltRoot ]; then
         --python_filename data/step2_cfg.py \
         --geometry DB:Extended \
         --era Run2_2018 \
-        -n -1 >& data/$recoOut
+        --nThreads $threads \
+        --nStreams $streams \
+        --no_exec \
+        -n -1 && cmsRun data/step2_cfg.py; } >& data/$recoOut || fail "Step 2: RAW2DIGI-L1Reco-RECO" $? data/$recoRoot
     echo "Step 2 completed"
+    stageOut copy data/$recoRoot
+    stageOut release data/$hltRoot
 else
     echo "reco file found printing contents"
     ls -lh data
 fi
 
+fi
+
 if $eventdisplay; then
 
     if [ ! -f data/eventdisplay.csv ]; then
         echo "Now analyzing the data"
         echo "Creating CSV from EDMAnalyzer over GEN-SIM"
-        cmsRun python/SpikedRHadronAnalyzer_cfg.py inputFiles=file:data/$genSimRoot outputFile=data/eventdisplay.csv
+        cmsRun python/SpikedRHadronAnalyzer_cfg.py inputFiles=file:data/$genSimRoot outputFile=data/eventdisplay.csv genProcess=$genProcess || fail "Event display" $? data/eventdisplay.csv
     fi
 
 fi
@@ -131,9 +308,13 @@ cd ..
 
 if $ntuple; then
 
-    if [ ! -f Demo/SpikedRHadronAnalyzer/data/NTuple.root ]; then
+    if [ ! -f SpikedRHadronAnalyzer/data/$ntupleRoot ]; then
     echo "Now running the NTuplizer over the RECO file"
-    cmsRun HSCParticleProducerAnalyzer_2018_SignalMC_cfg.py inputFiles=file:Demo/SpikedRHadronAnalyzer/data/$recoRoot outputFile=Demo/SpikedRHadronAnalyzer/data/NTuple.root 
+    cmsRun HSCParticleProducerAnalyzer_2018_SignalMC_cfg.py inputFiles=file:SpikedRHadronAnalyzer/data/$recoRoot outputFile=SpikedRHadronAnalyzer/data/$ntupleRoot || fail "NTuplizer" $? SpikedRHadronAnalyzer/data/$ntupleRoot
+    stageOut copy SpikedRHadronAnalyzer/data/$ntupleRoot
     fi  
 
 fi
+
+stageOut release SpikedRHadronAnalyzer/data/$genSimRoot
+stageOut release SpikedRHadronAnalyzer/data/$recoRoot
@@ -0,0 +1,46 @@
+#!/bin/bash
+
+# Purpose: Measures the GEN-SIM throughput (events/s) of one mass point for several thread counts and prints a
+#          markdown table for the README. Every run uses the same seeds and one stream per thread.
+# Usage:   ./throughputScan.sh MASS NEVENTS "THREADS..."
+#          e.g. ./throughputScan.sh 1800 200 "1 2 4 8"
+#          The wall time includes the initialisation of the job, use enough events for it to be small.
+
+mass=${1:-1800}
+events=${2:-100}
+threadList=${3:-"1 2 4 8"}
+cmEnergy=13000
+
+cd SpikedRHadronAnalyzer
+scanDir=data/throughputScan_M$mass
+mkdir -p $scanDir
+
+results=""
+baseline=""
+for threads in $threadList; do
+    log=$scanDir/gensim_${threads}threads.out
+    start=$(date +%s.%N)
+    cmsRun EXO-RunIISummer20UL18GENSIM-00010_1_cfg_v3.py maxEvents=$events seeded=True mass=$mass cmEnergy=$cmEnergy \
+        outputFile=$scanDir/gensim_${threads}threads.root genseed=123456789 g4seed=67890 vtxseed=345678 \
+        numberOfThreads=$threads numberOfStreams=$threads >& $log
+    status=$?
+    end=$(date +%s.%N)
+    if [[ $status -ne 0 ]]; then
+        echo "cmsRun failed with $threads threads (exit code $status), see $log"
+        continue
+    fi
+
+    wall=$(echo "$end - $start" | bc -l)
+    rate=$(echo "$events / $wall" | bc -l)
+    if [ -z "$baseline" ]; then
+        baseline=$rate
+    fi
+    speedup=$(echo "$rate / $baseline" | bc -l)
+    results+=$(printf "| %d | %d | %d | %.1f | %.3f | %.2f |" $threads $threads $events $wall $rate $speedup)$'\n'
+done
+
+echo "GEN-SIM throughput, M = $mass GeV, $(hostname), $(date +%F)"
+echo ""
+echo "| Threads | Streams | Events | Wall time [s] | Events/s | Speedup |"
+echo "|---|---|---|---|---|---|"
+printf "%s" "$results"